@@ -17,10 +17,13 @@
 
 /* Public typedefs/enums ------------------------------------------------------*/
 typedef struct {int16_t x, y, z;} xlda_out_t; // SDCC's endianness same as lsm6ds33
-typedef struct {int8_t xl;} xlda_ctrl_t;      // Add contiguous CTRL registers as needed
+typedef struct {int8_t xl; uint8_t fifo[3]; uint8_t int1; uint8_t g;} xlda_ctrl_t; // {CTRL1_XL}, {FIFO_CTRL3..5}, {INT1_CTRL}, {CTRL2_G}
 
 /* Public functions' prototypes -----------------------------------------------*/
 i2c_status_t xlda_init(const xlda_ctrl_t *ctrl);
 i2c_status_t xlda_read(xlda_out_t *pdata);
+#ifdef XLDA_INT1_WIRED
+void xlda_isr(void) __interrupt(IE1_VECTOR);
+#endif
 
 #endif // ACCEL_H
\ No newline at end of file
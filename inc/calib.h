@@ -0,0 +1,40 @@
+/**
+ ******************************************************************************
+ * @file    calib.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Header for calib.c file
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CALIB_H
+#define CALIB_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define CAL_VERSION 1 // Bump when cal_rec_t changes (older records fall back to config.h)
+
+/* Public typedefs/enums -----------------------------------------------------*/
+typedef enum {CAL_JX, CAL_JY, CAL_LX, CAL_LY} cal_axis_t; // Joystick and accelerometer (level) axes
+
+typedef struct {
+    uint8_t ver;
+    uint16_t jx_min, jx_max, jy_min, jy_max; // Joystick sweep in jstk_out_t units
+    int16_t lx, ly;                          // Accelerometer readings with the board level
+    uint8_t sum;                             // Makes the bytes of the record add up to 0
+} cal_rec_t;
+
+typedef uint8_t cal_status_t;
+enum {CAL_OK, CAL_RANGE_ERR, CAL_EE_ERR};
+
+/* Public functions' prototypes ----------------------------------------------*/
+void cal_load(void);
+void cal_defaults(cal_rec_t *rec);
+cal_status_t cal_save(cal_rec_t *rec);
+uint16_t cal_norm(cal_axis_t axis, uint16_t raw);
+
+#endif // CALIB_H
@@ -19,9 +19,9 @@
 
 /* main config definitions: */
 #define PLLCON_INIT_VAL    0x00     // Must be assigned to PLLCON at application entry
-#define INITIAL_POSITION   {10, 10}
-#define MAX_DELTA          0.5      // SCARA arm max movement step in centimeters (absolute value)
-#define AUTO_MODE_DELAY_MS 1000     // Delay between each auto mode step in milliseconds
+#define INITIAL_POSITION   {CM_TO_Q8(10), CM_TO_Q8(10)}
+#define MAX_SPEED          10.0     // SCARA arm speed at full input deflection in cm/s (JSTK/XLDA)
+#define MAX_STEP_MS        100      // Longest elapsed time integrated at once (stalls beyond it are dropped)
 #define DBNC_DELAY_MS      5        // Button debounce delay in milliseconds
 #define BTNA_CHK           BTN1_CHK
 #define BTNB_CHK           BTN2_CHK
@@ -35,8 +35,8 @@
     {-2.5, 9.5, 1},{-2.5, 8.5, 1}, {-2.5, 7.5, 1}, {-3.5, 7.5, 1}, {-4.5, 7.5, 1}, {-5.5, 7.5, 1},\
     {-6.5, 7.5, 1}, {-7.5, 7.5, 1}, {-7.5, 8.5, 1}, {-7.5, 9.5, 1}, {-7.5, 10.5, 1}, {-7.5, 11.5, 1},\
     {-7.5, 12.5, 1}, {-7.5, 12.5}} // (x+5)^2 + (y-10)^2 = 25 with square of lenght 5
-/* These may be transformed at compile time to their timer value equivalents, but
-runtime transformations still needed for JSTK/XLDA modes */
+/* Transformed at build time to their timer value equivalents (AUTO_MODE_CNTS) by
+tools/auto_path.c, which fails the build on unreachable points */
 
 /* joystick config definitions: */
 #define JSTK_FRONT_BTN_CHK BTN2_CHK
@@ -52,26 +52,62 @@ runtime transformations still needed for JSTK/XLDA modes */
 #define JSTK_X_MIN         55
 #define JSTK_Y_MAX         200  // [0 ≤ JSTK_Y_MIN ≤ JSTK_Y_MAX ≤ 255]
 #define JSTK_Y_MIN         55
-#define JSTK_THRSH         0.1  // Joystick input threshold (between 0 and 1.0)
+#define JSTK_THRSH         0.03 // Joystick input threshold (between 0 and 1.0), 0.1 advised with JSTK_HIRES 0
+#define JSTK_HIRES         1    // 1: 16-bit results through the decimation filter, 0: ADCxH only
+#define JSTK_FILT_SHIFT    3    // Filter over 2^JSTK_FILT_SHIFT conversions (0: unfiltered)
+#define JSTK_EXPO          0.3  // Response curve (0: linear, 1: cubic)
+
+/* i2c config definitions: */
+#define I2C_SPEED_HZ   400000 // 100000 (standard mode) or 400000 (fast mode), bit timing derived from PLLCON_INIT_VAL
+#define I2C_POLL_BYTES 4      // Bytes clocked per i2c_poll() for transactions run in the background
 
 /* accel config definitions: */
 #define LSM6DS_A0_VAL 1
-#define XLDA_ON_VALS  {0x50} // {CTRL1_XL} 208 Hz (normal mode)
-#define XLDA_OFF_VALS {0x00}
+#define XLDA_ON_VALS  {0x50, {0x01, 0x00, 0x2E}, 0x08, 0x50} // 208 Hz, XL-only continuous FIFO, INT1 on threshold (0x01: data-ready), gyro 208 Hz 245 dps
+#define XLDA_OFF_VALS {0x00, {0x00, 0x00, 0x00}, 0x00, 0x00} // Power-down, FIFO bypassed, INT1 off
+#define XLDA_ODR_HZ   208.0  // Output data rate set by XLDA_ON_VALS
+#define XLDA_FIFO     1      // 1: samples batched in the FIFO and averaged (one burst per batch), 0: STATUS_REG polling
+#define XLDA_FIFO_SHIFT 3    // 2^XLDA_FIFO_SHIFT samples per batch [0 to 5]
+#define XLDA_TIMEOUT_MS 20   // Allowed delay past the expected sample/batch before xlda_read() gives up
+#define XLDA_GYRO     0      // 1: gyroscope and accelerometer fused into a tilt (requires XLDA_FIFO 0), 0: accelerometer only
+#define XLDA_G_MDPS   8.75   // Gyroscope sensitivity in mdps/LSB, as set by XLDA_ON_VALS (245 dps full scale)
+#define XLDA_CF_MS    250    // Complementary filter time constant [60 to 1000]: gyroscope below, accelerometer above
+#define XLDA_TILT_DEG 30.0   // Tilt for full input deflection with XLDA_GYRO
 #define XLDA_X_MAX    32767  // [-32768 ≤ XLDA_X_MIN ≤ XLDA_X_MAX ≤ 32767] 
 #define XLDA_X_MIN    -32768
 #define XLDA_Y_MAX    32767  // [-32768 ≤ XLDA_Y_MIN ≤ XLDA_Y_MAX ≤ 32767]
 #define XLDA_Y_MIN    -32768 
-#define XLDA_THRSH    0.1    // Accelerometer input threshold (between 0 and 1.0)
+#define XLDA_THRSH    0.1    // Accelerometer input threshold (between 0 and 1.0), 0.03 advised with XLDA_GYRO 1
+#define XLDA_EXPO     0.3    // Response curve (0: linear, 1: cubic)
 
 /* lcd config definitions: */
 #define LCD_COLUMNS_PER_ROW 12
 
+/* calib config definitions: */
+#define CAL_EE_PAGE  0    // First Flash/EE data page of the calibration record
+#define CAL_MIN_SPAN 0.25 // Narrowest joystick sweep accepted (fraction of the ADC full scale)
+#define CAL_LVL_SHIFT 8   // Level averaged over 2^CAL_LVL_SHIFT accelerometer samples
+
 /* servo config definitions: */
 #define SV_L1            8.0    // Arm length of 'base' servo (in centimeters)
 #define SV_L2            9.0    // Arm length of 'mid' servo (in centimeters)
 #define SV_MAX_US_PULSE  2000.0 // HIGH pulse time for maximum angle in microseconds
 #define SV_MIN_US_PULSE  1000.0 // HIGH pulse time for minimum angle in microseconds
 #define SV_FREQUENCY     50.0   // Hz
+#define SV_NUM           3      // Servos from SV1_PIN upwards (4 adds AUX on SV4_PIN, shared with LED2)
+#define SV_MERGE_US      56     // Shortest edge interval, widths closer than this to an edge join it (at their group's midpoint), integer, > 1.25 * 45 machine cycles of TMR2 ISR latency
+#define SV_MAX_VEL       2500.0 // Pulse width slew rate limit in microseconds per second
+#define SV_MAX_ACC       10000.0 // Slew acceleration limit in microseconds per second²
+#define SV_QUEUE_LEN     4      // Committed vectors buffered ahead of the servo ISR (power of 2, in IDATA)
+#define SV_IK_MODE       SV_IK_FIXED // SV_IK_FLOAT, SV_IK_FIXED or SV_IK_GRID (see servo.h)
+#define SV_IK_GRID_SHIFT 7      // SV_IK_GRID cells of 2^SV_IK_GRID_SHIFT / 256 cm (7: 0.5 cm) [6 to 8]
+#define SV_IK_GRID_TOL   4      // SV_IK_GRID cells erring by more counts than this are given up
+#define SV_HW_PWM        0      // 1: BASE/MID frames from the PWM block (see lab_board.h), TIP on TMR2
+#define SV_PWMCON_VAL    0x37   // Twin 16-bit PWM mode clocked by fVCO/4 (48 Hz frames)
+#define SV_PWM_CLK_FREQ  (MAX_CORE_CLK / 4) // MHz, as selected by SV_PWMCON_VAL
+#if SV_HW_PWM
+#undef BTNA_CHK
+#define BTNA_CHK         BTN5_CHK // BTN1 (P1.1) carries PWM1
+#endif
 
 #endif // CONFIG_H
\ No newline at end of file
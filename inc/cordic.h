@@ -0,0 +1,31 @@
+/**
+ ******************************************************************************
+ * @file    cordic.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Header for cordic.c file
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CORDIC_H
+#define CORDIC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define BANG_PI  0x8000U // Binary angle of PI (full turn wraps at 2^16)
+#define CORDIC_1 16384   // Q14 unit of cordic_sincos' results
+
+/* Public typedefs/enums -----------------------------------------------------*/
+typedef uint16_t bang_t; // Binary angle
+
+/* Public functions' prototypes ----------------------------------------------*/
+bang_t cordic_atan2(int32_t y, int32_t x);
+uint32_t cordic_hypot(int32_t y, int32_t x);
+void cordic_sincos(bang_t a, int16_t *s, int16_t *c);
+uint16_t isqrt(uint32_t n);
+
+#endif // CORDIC_H
@@ -0,0 +1,30 @@
+/**
+ ******************************************************************************
+ * @file    flashee.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Header for flashee.c file
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FLASHEE_H
+#define FLASHEE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define EE_PAGE_SIZE 4    // Bytes per Flash/EE data page (EDATA1..4)
+#define EE_PAGES     1024 // 4 kB of Flash/EE data memory
+
+/* Public typedefs/enums -----------------------------------------------------*/
+typedef bool ee_status_t;
+enum {EE_OK, EE_ERR};
+
+/* Public functions' prototypes ----------------------------------------------*/
+void ee_read(uint16_t page, uint8_t *pdata, uint8_t datalen);
+ee_status_t ee_write(uint16_t page, const uint8_t *pdata, uint8_t datalen);
+
+#endif // FLASHEE_H
@@ -0,0 +1,28 @@
+/**
+ ******************************************************************************
+ * @file    fmt.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Header for fmt.c file
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FMT_H
+#define FMT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define FMT_U16_LEN 6 // "65535" plus the terminator
+#define FMT_I16_LEN 7 // "-32768" plus the terminator
+#define FMT_Q8_LEN  8 // "-128.00" plus the terminator
+
+/* Public functions' prototypes ----------------------------------------------*/
+uint8_t fmt_u16(char *s, uint16_t val);
+uint8_t fmt_i16(char *s, int16_t val);
+uint8_t fmt_q8(char *s, int16_t val);
+
+#endif // FMT_H
@@ -17,15 +17,30 @@
 
 /* Public defines ------------------------------------------------------------*/
 #define BYTE_MSB_MASK 0x80U
+#define I2C_RECOVER_CLOCKS 9 // SCL pulses clocking a stuck slave out of a byte (8 data + ACK)
 
 /* Public typedefs/enums -----------------------------------------------------*/
-typedef bool i2c_status_t;
-enum {I2C_ACK, I2C_NACK};
+typedef uint8_t i2c_status_t;
+enum {I2C_ACK, I2C_NACK, I2C_BUS_ERR, I2C_TIMEOUT}; // I2C_TIMEOUT: device not ready before its deadline
+
+typedef struct {
+    uint8_t devaddr;     // Target 7-bit I2C device address, MSB set to ignore memaddr
+    uint8_t memaddr;     // Internal memory address
+    uint8_t *pdata;      // Data buffer, advanced as bytes are transferred
+    uint8_t datalen;     // Bytes left
+    _Bool rd;            // Read from (1) or write to (0) the device
+    _Bool done;          // Completion flag, status valid once set
+    i2c_status_t status; // As returned by i2c_memread()/i2c_memwrite()
+    uint8_t phase;       // Private to i2c.c
+} i2c_xfer_t;
 
 /* Public functions' prototypes ----------------------------------------------*/
 void i2c_init(void);
 i2c_status_t i2c_memwrite(uint8_t devaddr, uint8_t memaddr, const uint8_t *pdata, uint8_t datalen);
 i2c_status_t i2c_memread(uint8_t devaddr, uint8_t memaddr, uint8_t *pdata, uint8_t datalen);
+i2c_status_t i2c_recover(void);
+bool i2c_submit(i2c_xfer_t *xfer);
+void i2c_poll(void);
 
 /* Public inline functions' definitions --------------------------------------*/
 
@@ -39,4 +54,14 @@ inline i2c_status_t i2c_read(uint8_t devaddr, uint8_t *pdata, uint8_t datalen)
     return i2c_memread(devaddr | BYTE_MSB_MASK, 0, pdata, datalen);
 }
 
+inline bool i2c_memread_async(i2c_xfer_t *xfer, uint8_t devaddr, uint8_t memaddr, uint8_t *pdata, uint8_t datalen)
+{
+    xfer->devaddr = devaddr;
+    xfer->memaddr = memaddr;
+    xfer->pdata = pdata;
+    xfer->datalen = datalen;
+    xfer->rd = true;
+    return i2c_submit(xfer);
+}
+
 #endif // I2C_H
\ No newline at end of file
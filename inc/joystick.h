@@ -15,8 +15,24 @@
 /* Includes ------------------------------------------------------------------*/
 #include "utils.h"
 
+/* Public defines ------------------------------------------------------------*/
+#if JSTK_HIRES
+#define JSTK_BITS 16
+#else
+#define JSTK_BITS 8
+#endif
+
+/* Public macros -------------------------------------------------------------*/
+#define JSTK_RAW(A) ((A) * (1UL << (JSTK_BITS - 8))) // JSTK_X/Y_MIN/MAX (8-bit) to jstk_out_t's x/y scale
+
 /* Public typedefs/enums -----------------------------------------------------*/
-typedef struct {uint8_t x, y;} jstk_out_t;
+#if JSTK_HIRES
+typedef uint16_t jstk_raw_t;
+typedef struct {jstk_raw_t x, y; uint16_t noise; uint8_t seq;} jstk_out_t; // noise: mean |x/y - sample|
+#else
+typedef uint8_t jstk_raw_t;
+typedef struct {jstk_raw_t x, y; uint8_t seq;} jstk_out_t; // seq changes with every fresh pair of conversions
+#endif
 
 typedef bool adc_status_t;
 enum {ADC_OK, ADC_ERR};
@@ -24,6 +40,7 @@ enum {ADC_OK, ADC_ERR};
 /* Public functions' prototypes ----------------------------------------------*/
 void jstk_init(void);
 adc_status_t jstk_read(jstk_out_t *pdata);
+void jstk_isr(void) __interrupt(RDY0_VECTOR);
 
 /* Public inline functions' definitions --------------------------------------*/
 
@@ -33,6 +50,7 @@ adc_status_t jstk_read(jstk_out_t *pdata);
  */
 inline void jstk_disable(void)
 {
+    EADC = 0;
     ADCMODE &= ~(ADC0EN | ADC1EN);
 }
 
@@ -28,6 +28,8 @@
 #define SV2_PIN            5
 #define SV3_PIN            6
 #define SV4_PIN            7
+/* With SV_HW_PWM, SV1 (BASE) and SV2 (MID) lines move to PWM0 (P1.0) and PWM1 (P1.1).
+   P1.1 is also BTN1 (BTNA then moves to BTN5 in config.h, any BTN1_CHK left fails to compile) */
 
 #define PORT_LED           P0
 #define LED2_PIN_MASK      (1u << 7)
@@ -38,6 +40,10 @@
 #define PORT_LCD_D         P2
 #define LCD_RS_SBIT        P3_6
 #define LCD_E_SBIT         P3_7
+//#define LCD_RW_SBIT        P3_4 // Busy flag polling if wired (fixed delays with RW tied to GND)
+
+/* LSM6DS33 INT1 wired to INT1 (P3.3), BTN5 must then be left unused (BTN5_CHK fails to compile) */
+//#define XLDA_INT1_WIRED
 
 #define PORT_LCD_LED       P2
 #define LCD_RED_LED_MASK   (1u << 1)
@@ -18,7 +18,7 @@
 /* Public defines ------------------------------------------------------------*/
 #define ENABLE_PUTU
 //#define ENABLE_PUTI
-#define ENABLE_PUTF
+#define ENABLE_PUTQ8
 
 /* Public typedefs/enums -----------------------------------------------------*/
 enum lcd_command {
@@ -84,6 +84,8 @@ void lcd_init(void);
 void lcd_cmd(uint8_t cmd); // No enum type to avoid CG/DDRAM address warnings
 void lcd_putchar(char c);
 void lcd_puts(const char *str);
+void lcd_flush(void);
+void lcd_isr(void) __interrupt(TF1_VECTOR);
 
 #ifdef ENABLE_PUTU
 void lcd_putu(uint16_t val);
@@ -93,8 +95,8 @@ void lcd_putu(uint16_t val);
 void lcd_puti(int16_t val);
 #endif
 
-#ifdef ENABLE_PUTF
-void lcd_putf(float val);
+#ifdef ENABLE_PUTQ8
+void lcd_putq8(int16_t val);
 #endif
 
 /* Public inline functions' definitions --------------------------------------*/
@@ -53,6 +53,19 @@
 #define CTRL9_XL 0x18
 #define CTRL10_C 0x19
 
+// INT1_CTRL register bits
+#define INT1_STEP_DETECTOR (1 << 7)
+#define INT1_SIGN_MOT      (1 << 6)
+#define INT1_FULL_FLAG     (1 << 5)
+#define INT1_FIFO_OVR      (1 << 4)
+#define INT1_FTH           (1 << 3)
+#define INT1_BOOT          (1 << 2)
+#define INT1_DRDY_G        (1 << 1)
+#define INT1_DRDY_XL       (1 << 0)
+
+// FIFO_CTRL5 register bits
+#define FIFO_MODE_MASK 0x07 // 0: bypass (FIFO emptied)
+
 // CTRL1_XL register bits
 #define ODR_XL3 (1 << 7)
 #define ODR_XL2 (1 << 6)
@@ -63,6 +76,16 @@
 #define BW_XL1  (1 << 1)
 #define BW_XL0  (1 << 0)
 
+// CTRL3_C register bits
+#define BOOT      (1 << 7)
+#define BDU       (1 << 6)
+#define H_LACTIVE (1 << 5)
+#define PP_OD     (1 << 4)
+#define SIM       (1 << 3)
+#define IF_INC    (1 << 2)
+#define BLE       (1 << 1)
+#define SW_RESET  (1 << 0)
+
 // CTRL9_XL register bits
 #define Zen_XL (1 << 5)
 #define Yen_XL (1 << 4)
@@ -107,6 +130,13 @@
 #define FIFO_STATUS3 0x3C
 #define FIFO_STATUS4 0x3D
 
+// FIFO_STATUS2 register bits
+#define FIFO_FTH          (1 << 7)
+#define FIFO_OVER_RUN     (1 << 6)
+#define FIFO_FULL         (1 << 5)
+#define FIFO_EMPTY        (1 << 4)
+#define DIFF_FIFO_H_MASK  0x0F
+
 // FIFO data output registers
 #define FIFO_DATA_OUT_L 0x3E
 #define FIFO_DATA_OUT_H 0x3F
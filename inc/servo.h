@@ -20,26 +20,43 @@
 #define MAX_ANGLE PI  // Rad
 #define MIN_ANGLE 0.0 // Rad
 
+#define SV_IK_FLOAT 0 // sv_move() through the soft-float library (atan2f/sqrtf)
+#define SV_IK_FIXED 1 // sv_move() through integer math (Q8 cm, binary angles)
+#define SV_IK_GRID  2 // sv_move() through a bilinear lookup of counts tabulated at build time
+
+#define Q8_ONE 256 // Unit of point_t's coordinates
+
 #define SV_MIN_CNT    US_TO_MC(SV_MIN_US_PULSE)
 #define SV_MAX_CNT    US_TO_MC(SV_MAX_US_PULSE)
 #define SV_MID_CNT    US_TO_MC((SV_MAX_US_PULSE + SV_MIN_US_PULSE) / 2.0)
-#define SV_PERIOD_CNT (US_TO_MC(1e6 / SV_FREQUENCY) - 2 * SV_MID_CNT)
+#define SV_FRAME_CNT  US_TO_MC(1e6 / SV_FREQUENCY)
+#define SV_MERGE_CNT  US_TO_MC(SV_MERGE_US)
 
 #define SV_MIN_EXCT (SV_MIN_US_PULSE * CORE_CLK_FREQ / 12)
 #define SV_MAX_EXCT (SV_MAX_US_PULSE * CORE_CLK_FREQ / 12)
 
 /* Public macros --------------------------------------------------------------*/
 #define SV_RTOC(A) ((uint16_t)(LERP(A, MIN_ANGLE, MAX_ANGLE, SV_MIN_EXCT, SV_MAX_EXCT) + 0.5))
+#define CM_TO_Q8(A) ((int16_t)ROUND((A) * Q8_ONE)) // Centimeters to point_t coordinates
 
 /* Public typedefs/enums ------------------------------------------------------*/
-typedef enum {BASE, MID, TIP} servo_t;
-typedef struct {float x, y; _Bool z;} point_t;
+typedef enum {BASE, MID, TIP, AUX} servo_t;
+typedef struct {int16_t x, y; _Bool z;} point_t; // Q8 centimeters
+typedef uint16_t sv_arm_t[TIP + 1]; // Pulse widths of each servo_t in machine cycles
 
 /* Public functions' prototypes -----------------------------------------------*/
 void sv_init(void);
 bool sv_setcnt(servo_t sv, uint16_t cnt);
 bool sv_move(const point_t *p);
-void sv_isr(void) __interrupt(TF2_VECTOR) __naked;
+bool sv_setarm(const sv_arm_t cnt);
+bool sv_commit(void);
+void sv_stream(bool on);
+bool sv_busy(void);
+bool sv_full(void);
+void sv_gap(void);
+uint8_t sv_overruns(void);
+uint8_t sv_underruns(void);
+void sv_isr(void) __interrupt(TF2_VECTOR) __using(1);
 
 /** ASSUMED ARM CONFIGURATION FOR ANGLE CALCULATIONS **/
 /** WHERE SV_MIN_US_PULSE EQUALS 0 AS MEASURED BELOW **/
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * @file    shape.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Input shaping stage (deadzone, expo curve and saturation lookup tables)
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef SHAPE_H
+#define SHAPE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define SHAPE_ONE 256 // Output at full deflection (Q8)
+
+/* Public macros -------------------------------------------------------------*/
+/* Raw value R to [-1, 1] over [MIN, MAX] (not clamped) */
+#define SHAPE_NORM(R, MIN, MAX) (2.0 * ((R) - (MIN)) / ((MAX) - (MIN)) - 1)
+/* Non-negative side: deadzone T, saturation and expo curve E (0: linear, 1: cubic) */
+#define SHAPE_POS(U, T, E) ((U) <= (T) ? 0.0 : (U) >= 1 ? 1.0 : \
+    ((U) - (T)) / (1 - (T)) * (1 - (E) + (E) * ((U) - (T)) / (1 - (T)) * ((U) - (T)) / (1 - (T))))
+#define SHAPE_Q8(U, T, E) ((int16_t)(SHAPE_POS(U, T, E) * SHAPE_ONE + 0.5))
+#define SHAPE_ENT(R, MIN, MAX, T, E) (SHAPE_NORM(R, MIN, MAX) >= 0 ? SHAPE_Q8(SHAPE_NORM(R, MIN, MAX), T, E) : \
+    -SHAPE_Q8(-SHAPE_NORM(R, MIN, MAX), T, E))
+
+#define SHAPE_X16(M, H, OFS, STP, ...) \
+    M((OFS) + ((H) * 16 + 0) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 1) * (STP), __VA_ARGS__),   \
+    M((OFS) + ((H) * 16 + 2) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 3) * (STP), __VA_ARGS__),   \
+    M((OFS) + ((H) * 16 + 4) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 5) * (STP), __VA_ARGS__),   \
+    M((OFS) + ((H) * 16 + 6) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 7) * (STP), __VA_ARGS__),   \
+    M((OFS) + ((H) * 16 + 8) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 9) * (STP), __VA_ARGS__),   \
+    M((OFS) + ((H) * 16 + 10) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 11) * (STP), __VA_ARGS__), \
+    M((OFS) + ((H) * 16 + 12) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 13) * (STP), __VA_ARGS__), \
+    M((OFS) + ((H) * 16 + 14) * (STP), __VA_ARGS__), M((OFS) + ((H) * 16 + 15) * (STP), __VA_ARGS__)
+#define SHAPE_X256(OFS, STP, ...) \
+    SHAPE_X16(SHAPE_ENT, 0, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 1, OFS, STP, __VA_ARGS__),   \
+    SHAPE_X16(SHAPE_ENT, 2, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 3, OFS, STP, __VA_ARGS__),   \
+    SHAPE_X16(SHAPE_ENT, 4, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 5, OFS, STP, __VA_ARGS__),   \
+    SHAPE_X16(SHAPE_ENT, 6, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 7, OFS, STP, __VA_ARGS__),   \
+    SHAPE_X16(SHAPE_ENT, 8, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 9, OFS, STP, __VA_ARGS__),   \
+    SHAPE_X16(SHAPE_ENT, 10, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 11, OFS, STP, __VA_ARGS__), \
+    SHAPE_X16(SHAPE_ENT, 12, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 13, OFS, STP, __VA_ARGS__), \
+    SHAPE_X16(SHAPE_ENT, 14, OFS, STP, __VA_ARGS__), SHAPE_X16(SHAPE_ENT, 15, OFS, STP, __VA_ARGS__)
+
+/* Initializers of the __code tables read by shape_u8() and shape_u16(), evaluated at compile time */
+#define SHAPE_LUT8(MIN, MAX, T, E) {SHAPE_X256(0, 1, MIN, MAX, T, E)} // Raw 0 to 255
+#define SHAPE_LUT16(OFS, MIN, MAX, T, E) \
+    {SHAPE_X256(OFS, 256.0, MIN, MAX, T, E), SHAPE_ENT((OFS) + 65536.0, MIN, MAX, T, E)} // Raw OFS to OFS + 65535
+
+/* Public inline functions' definitions --------------------------------------*/
+
+/**
+ * @brief  Shape an 8-bit raw value
+ * @param  lut Table initialized with SHAPE_LUT8
+ * @param  a Raw value
+ * @retval Shaped value (±SHAPE_ONE at full deflection)
+ */
+inline int16_t shape_u8(const int16_t __code *lut, uint8_t a)
+{
+    return lut[a];
+}
+
+/**
+ * @brief  Shape a 16-bit raw value (by interpolation between 256 steps)
+ * @param  lut Table initialized with SHAPE_LUT16
+ * @param  a Raw value minus the table's OFS
+ * @note   Works on the magnitude of the step to keep to MUL AB, valid while adjacent
+ *         entries differ by less than 256: MAX - MIN > 512 * (1 + 2E) / (1 - T)
+ * @retval Shaped value (±SHAPE_ONE at full deflection)
+ */
+inline int16_t shape_u16(const int16_t __code *lut, uint16_t a)
+{
+    int16_t y = lut[HIGHBYTE(a)], d = lut[HIGHBYTE(a) + 1] - y;
+    if (d >= 0)
+        return y + ((uint16_t)(LOWBYTE(d) * LOWBYTE(a)) >> 8);
+    return y - ((uint16_t)(LOWBYTE(-d) * LOWBYTE(a)) >> 8);
+}
+
+#endif // SHAPE_H
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * @file    timer.h
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Header for timer.c file
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef TIMER_H
+#define TIMER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "utils.h"
+
+/* Public defines ------------------------------------------------------------*/
+#define TMR_TICK_FREQ (CORE_CLK_FREQ * 1e6 / (12 * 256)) // Hz (4096 at 12.58 MHz)
+
+/* Public macros --------------------------------------------------------------*/
+#define TMR_US(A) ((tmr_t)((A) * TMR_TICK_FREQ / 1e6) + 2) // Ticks covering at least A uS from any tmr_now()
+#define TMR_MS(A) TMR_US((A) * 1e3)                         // Up to half the tmr_t range (8 s at 12.58 MHz)
+
+/* TMR0 as a machine cycle counter for benchmarking (uint16_t T, up to 65535 cycles) */
+#define BENCH_START(T) ((T) = tmr_cycles())
+#define BENCH_STOP(T)  ((uint16_t)(tmr_cycles() - (T)))
+
+/* Public typedefs/enums -----------------------------------------------------*/
+typedef uint16_t tmr_t; // Ticks of 256 machine cycles, wraps around
+
+/* Public functions' prototypes ----------------------------------------------*/
+void tmr_init(void);
+tmr_t tmr_now(void);
+uint16_t tmr_cycles(void);
+void tmr_wait(tmr_t ticks);
+void tmr_isr(void) __interrupt(TF0_VECTOR) __naked;
+
+/* Public inline functions' definitions --------------------------------------*/
+
+/**
+ * @brief  Check a deadline without blocking
+ * @param  deadline Value of tmr_now() to be reached (e.g. tmr_now() + TMR_MS(5))
+ * @note   Wrap-around safe for deadlines up to half the tmr_t range ahead
+ * @retval True if the deadline has been reached, false otherwise
+ */
+inline bool tmr_expired(tmr_t deadline)
+{
+    return (int16_t)(tmr_now() - deadline) >= 0;
+}
+
+#endif // TIMER_H
\ No newline at end of file
@@ -24,7 +24,6 @@
 #define PLLCON_CD_MASK 0x07U
 #define MAX_CORE_CLK   12.582912 // MHz
 #define CORE_CLK_FREQ  (MAX_CORE_CLK / (1U << (PLLCON_INIT_VAL & PLLCON_CD_MASK)))
-#define OVHEAD_CONST   16.023 // Loop overhead constant for volatile uint16_t (measured debugging)
 
 /* Public macros -------------------------------------------------------------*/
 #define LOWBYTE(A)  ((uint8_t)(A))                  // Only for r-values
@@ -32,7 +31,6 @@
 #define ARR_SIZE(A) (sizeof(A) / sizeof(*(A)))      // Size of array (only within scope of initialization)
 
 #define US_TO_MC(A) ((uint16_t)((A) * CORE_CLK_FREQ / 12 + 0.5)) // uS to machine cycles
-#define DELAY_US(A) do {for (volatile uint16_t i = US_TO_MC((A) / OVHEAD_CONST); i; i--);} while (0)
 
 #define ROUND(A) ((int64_t)((A) + ((A) >= 0 ? 0.5 : -0.5))) // For compile-time operations with unknown sign
 #define LERP(A,B,C,D,E) (((E)-(D))*((A)-(B))/((C)-(B))+(D)) // Linear interpolation of A from interval [B-C] to [D-E]
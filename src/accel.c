@@ -11,26 +11,424 @@
 /* Includes ------------------------------------------------------------------*/
 #include "accel.h"
 #include "lsm6ds33.h"
+#include "timer.h"
+#include "cordic.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define XLDA_AXES        3 // FIFO words per sample (X, Y, Z)
+#define XLDA_FIFO_WORDS  (XLDA_AXES << XLDA_FIFO_SHIFT)
+#define XLDA_FTH         (XLDA_FIFO_WORDS + XLDA_AXES - 1) // A whole batch whatever the FIFO pattern
+#define XLDA_SMP_TICKS   TMR_US(1e6 / XLDA_ODR_HZ)
+#define XLDA_BATCH_TICKS TMR_US((1e6 / XLDA_ODR_HZ) * (1U << XLDA_FIFO_SHIFT))
+#if XLDA_FIFO
+#define XLDA_TMO_TICKS   (XLDA_BATCH_TICKS + TMR_MS(XLDA_TIMEOUT_MS))
+#else
+#define XLDA_TMO_TICKS   (XLDA_SMP_TICKS + TMR_MS(XLDA_TIMEOUT_MS))
+#endif
+#ifdef XLDA_INT1_WIRED
+#define CTRL3_C_INT1     H_LACTIVE // INT1 active low
+#else
+#define CTRL3_C_INT1     0
+#endif
+#define CTRL3_C_VAL      (BDU | CTRL3_C_INT1 | IF_INC) // Outputs held until read (no torn burst), register auto-increment
+#define XLDA_DT_MAX      TMR_MS(50) // Longest gap integrated, the tilt is seeded again beyond it
+#define XLDA_G_SHIFT     2
+#define XLDA_G_K         ((int32_t)ROUND(XLDA_G_MDPS * 1e-3 * 65536 / 360 * 65536 / TMR_TICK_FREQ * (1 << XLDA_G_SHIFT)))
+#define XLDA_CF_K        ((int32_t)ROUND(65536.0 / TMR_MS(XLDA_CF_MS))) // Q16 binary angle per tick and unit of error
+#define XLDA_TILT_K      ((int32_t)ROUND(180.0 * 256 / XLDA_TILT_DEG)) // Binary angle to ±32767 (Q8)
+
+#if XLDA_FIFO && XLDA_FIFO_SHIFT > 5
+#error "XLDA_FIFO_SHIFT must be 5 at most (burst length limited to 255 bytes)"
+#endif
+
+#if XLDA_GYRO && XLDA_FIFO
+#error "XLDA_GYRO requires XLDA_FIFO 0 (accelerometer and gyroscope read together per sample)"
+#endif
+
+#if XLDA_GYRO || XLDA_FIFO || defined(XLDA_INT1_WIRED)
+#define XLDA_BG 1 // Samples read in the background (see xlda_read)
+#else
+#define XLDA_BG 0
+#endif
+
+/* Private typedefs/enums -----------------------------------------------------*/
+enum {XLDA_IDLE, XLDA_STATUS, XLDA_DATA}; // Background read phases
+typedef struct {xlda_out_t g, xl;} xlda_gxl_t; // OUTX_L_G..OUTZ_H_XL, one burst
+
+/* Private variables ----------------------------------------------------------*/
+#if XLDA_FIFO
+static __xdata xlda_out_t xlda_burst[(1U << XLDA_FIFO_SHIFT) + 1]; // A batch plus realignment
+#endif
+#if XLDA_BG
+static xlda_out_t xlda_avg; // Latest sample, or average of the latest batch
+static bool xlda_valid;     // xlda_avg holds data
+static tmr_t xlda_stale;    // Deadline for the next sample/batch
+static __idata i2c_xfer_t xlda_xfer; // Background read, advanced by i2c_poll()
+static uint8_t xlda_phase;  // Transaction in xlda_xfer (XLDA_IDLE if none)
+#endif
+#if XLDA_FIFO
+static uint8_t xlda_st[FIFO_STATUS4 - FIFO_STATUS1 + 1]; // FIFO_STATUS1..4
+static uint8_t xlda_skip;   // Words read ahead of the batch (FIFO_PATTERN realignment)
+static uint8_t xlda_ctrl5;  // FIFO_CTRL5 restored after a flush
+#elif XLDA_GYRO
+static xlda_gxl_t xlda_gxl; // Sample being read, fused into xlda_avg once complete
+static int32_t xlda_tx, xlda_ty; // Fused tilt about Y and X (Q16 binary angles)
+static tmr_t xlda_t;        // tmr_now() of the previous fused sample
+static bool xlda_fused;     // xlda_tx/xlda_ty seeded
+#elif defined(XLDA_INT1_WIRED)
+static xlda_out_t xlda_smp; // Sample being read, copied to xlda_avg once complete
+#endif
+#ifdef XLDA_INT1_WIRED
+static volatile bool xlda_drdy; // Set by xlda_isr(), INT1 then masked until the data is read
+#elif XLDA_FIFO || XLDA_GYRO
+static tmr_t xlda_due; // Next FIFO_STATUS poll or sample read
+#endif
+
+/* Private functions' prototypes -----------------------------------------------*/
+#if XLDA_BG
+static i2c_status_t xlda_step(void);
+static i2c_status_t xlda_take(xlda_out_t *pdata);
+#endif
+#if XLDA_GYRO
+static void xlda_fuse(void);
+static int16_t xlda_tilt(int32_t t);
+#endif
 
 /**
  * @brief Initialize the accelerometer of the LSM6DS33
  * @param ctrl Pointer to xlda_ctrl_t containing CTRL_X values
- * @retval I2C_ACK if connection established, I2C_NACK otherwise
+ * @note With XLDA_FIFO, the FIFO threshold is set to one batch. With XLDA_GYRO, the
+ *       gyroscope is set by CTRL2_G. The output registers are set by CTRL3_C (block
+ *       data update). With XLDA_INT1_WIRED, INT1 is made active low and enabled as a
+ *       level-triggered interrupt if routed
+ * @retval I2C_ACK if connection established, the i2c_status_t error otherwise
  */
 i2c_status_t xlda_init(const xlda_ctrl_t *ctrl)
 {
+    i2c_status_t status;
+    static const uint8_t ctrl3 = CTRL3_C_VAL;
+#if XLDA_FIFO
+    uint8_t fifo[FIFO_CTRL5 - FIFO_CTRL1 + 1] = {LOWBYTE(XLDA_FTH), HIGHBYTE(XLDA_FTH)};
+    fifo[2] = ctrl->fifo[0];
+    fifo[3] = ctrl->fifo[1];
+    fifo[4] = ctrl->fifo[2];
+    xlda_ctrl5 = ctrl->fifo[2];
+#endif
+#ifdef XLDA_INT1_WIRED
+    EX1 = 0;
+    IT1 = 0;
+    xlda_drdy = false;
+#elif XLDA_FIFO || XLDA_GYRO
+    xlda_due = tmr_now();
+#endif
+#if XLDA_GYRO
+    xlda_fused = false;
+#endif
+#if XLDA_BG
+    xlda_valid = false;
+    xlda_stale = tmr_now() + XLDA_TMO_TICKS;
+    xlda_phase = XLDA_IDLE; // A read in flight is completed by i2c_init()
+#endif
     i2c_init();
-    return i2c_memwrite(LSM6DS_I2CADDR, CTRL1_XL, (uint8_t *)ctrl, sizeof(*ctrl));
+#if XLDA_FIFO
+    status = i2c_memwrite(LSM6DS_I2CADDR, FIFO_CTRL1, fifo, sizeof(fifo));
+    if (status)
+        return status;
+#endif
+#if XLDA_GYRO
+    status = i2c_memwrite(LSM6DS_I2CADDR, CTRL2_G, &ctrl->g, sizeof(ctrl->g));
+    if (status)
+        return status;
+#endif
+    status = i2c_memwrite(LSM6DS_I2CADDR, CTRL3_C, &ctrl3, sizeof(ctrl3));
+    if (status)
+        return status;
+#ifdef XLDA_INT1_WIRED
+    status = i2c_memwrite(LSM6DS_I2CADDR, INT1_CTRL, &ctrl->int1, sizeof(ctrl->int1));
+    if (status)
+        return status;
+    EA = 1;
+    EX1 = ctrl->int1 != 0;
+#endif
+    return i2c_memwrite(LSM6DS_I2CADDR, CTRL1_XL, (uint8_t *)&ctrl->xl, sizeof(ctrl->xl));
 }
 
+#if XLDA_BG
 /**
  * @brief Read the value of the three axes of the accelerometer
  * @param pdata Pointer to xlda_out_t used for data reception
- * @retval I2C_ACK if connection established, I2C_NACK otherwise
+ * @note The latest sample (average of the latest batch with XLDA_FIFO, fused tilt
+ *       with XLDA_GYRO, see xlda_fuse) is returned
+ *       while the next one is read in the background, the transactions being
+ *       advanced by i2c_poll() from the main loop. Only the first call waits
+ *       (XLDA_TMO_TICKS at most), running the bus itself
+ * @retval I2C_ACK if data available, I2C_TIMEOUT if no sample/batch came in time, the
+ *         i2c_status_t error otherwise
  */
 i2c_status_t xlda_read(xlda_out_t *pdata)
 {
-    while (!i2c_memread(LSM6DS_I2CADDR, STATUS_REG, (uint8_t *)pdata, sizeof(uint8_t)) &&
-           !(*(uint8_t *)pdata & SR_XLDA));
-    return i2c_memread(LSM6DS_I2CADDR, OUTX_L_XL, (uint8_t *)pdata, sizeof(*pdata));
-}
\ No newline at end of file
+    i2c_status_t status;
+    do {
+        status = xlda_step();
+        if (status)
+            return status;
+        if (!xlda_valid)
+            i2c_poll();
+    } while (!xlda_valid && !tmr_expired(xlda_stale));
+    return xlda_take(pdata);
+}
+#endif
+
+#if XLDA_FIFO
+/**
+ * @brief Advance the background read of a FIFO batch
+ * @note FIFO_STATUS polled once per batch (on INT1 if wired, on a batch period otherwise),
+ *       then the whole batch drained in one burst (the address rolls back from
+ *       FIFO_DATA_OUT_H to FIFO_DATA_OUT_L) and averaged into xlda_avg. A backlog of
+ *       two batches or more (xlda_read() called less often than batches come) is
+ *       flushed through bypass mode instead, so the next batch averaged is a fresh one
+ * @retval I2C_ACK unless the last transaction failed
+ */
+static i2c_status_t xlda_step(void)
+{
+    uint8_t skip, i, mode;
+    uint16_t words;
+    i2c_status_t status;
+    int32_t sx, sy, sz;
+    const xlda_out_t __xdata *smp;
+    switch (xlda_phase) {
+    case XLDA_IDLE:
+#ifdef XLDA_INT1_WIRED
+        if (!xlda_drdy || !i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, FIFO_STATUS1, xlda_st, sizeof(xlda_st)))
+            return I2C_ACK;
+        xlda_drdy = false;
+#else
+        if (!tmr_expired(xlda_due) || !i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, FIFO_STATUS1, xlda_st, sizeof(xlda_st)))
+            return I2C_ACK;
+#endif
+        xlda_phase = XLDA_STATUS;
+        return I2C_ACK;
+    case XLDA_STATUS:
+        if (!xlda_xfer.done)
+            return I2C_ACK;
+        xlda_phase = XLDA_IDLE;
+        if (xlda_xfer.status)
+            return xlda_xfer.status;
+        words = (uint16_t)(xlda_st[1] & DIFF_FIFO_H_MASK) << 8 | xlda_st[0];
+        skip = xlda_st[2] ? XLDA_AXES - xlda_st[2] : 0; // Words up to the next X (FIFO_PATTERN)
+        if (words >= skip + 2 * XLDA_FIFO_WORDS) { // Stale batches queued ahead of the newest one
+            mode = xlda_ctrl5 & ~FIFO_MODE_MASK;
+            status = i2c_memwrite(LSM6DS_I2CADDR, FIFO_CTRL5, &mode, sizeof(mode));
+            if (!status)
+                status = i2c_memwrite(LSM6DS_I2CADDR, FIFO_CTRL5, &xlda_ctrl5, sizeof(xlda_ctrl5));
+            if (status)
+                return status;
+            words = 0; // Refilled from FIFO_PATTERN 0
+        }
+        if (words < skip + XLDA_FIFO_WORDS) {
+#ifdef XLDA_INT1_WIRED
+            EX1 = 1;
+#else
+            xlda_due = tmr_now() + XLDA_SMP_TICKS;
+#endif
+            return I2C_ACK;
+        }
+        if (!i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, FIFO_DATA_OUT_L, (uint8_t *)xlda_burst, 2 * (skip + XLDA_FIFO_WORDS))) {
+#ifdef XLDA_INT1_WIRED
+            xlda_drdy = true; // FIFO_STATUS read again on the next call
+#endif
+            return I2C_ACK;
+        }
+        xlda_skip = skip;
+        xlda_phase = XLDA_DATA;
+        return I2C_ACK;
+    default:
+        if (!xlda_xfer.done)
+            return I2C_ACK;
+        xlda_phase = XLDA_IDLE;
+        if (xlda_xfer.status)
+            return xlda_xfer.status;
+        smp = (const xlda_out_t __xdata *)((uint8_t __xdata *)xlda_burst + 2 * xlda_skip);
+        sx = sy = sz = 0;
+        for (i = 0; i < 1U << XLDA_FIFO_SHIFT; i++) {
+            sx += smp[i].x;
+            sy += smp[i].y;
+            sz += smp[i].z;
+        }
+        xlda_avg.x = sx >> XLDA_FIFO_SHIFT;
+        xlda_avg.y = sy >> XLDA_FIFO_SHIFT;
+        xlda_avg.z = sz >> XLDA_FIFO_SHIFT;
+        xlda_valid = true;
+        xlda_stale = tmr_now() + XLDA_TMO_TICKS;
+#ifdef XLDA_INT1_WIRED
+        EX1 = 1; // Fires again right away if the FIFO is still over the threshold
+#else
+        xlda_due = tmr_now() + XLDA_BATCH_TICKS; // Less than a batch left (backlogs are flushed)
+#endif
+        return I2C_ACK;
+    }
+}
+#elif XLDA_GYRO
+/**
+ * @brief Advance the background read of a gyroscope and accelerometer sample
+ * @note Read after a data-ready interrupt if wired, once per output data period otherwise
+ * @retval I2C_ACK unless the last transaction failed
+ */
+static i2c_status_t xlda_step(void)
+{
+    if (xlda_phase == XLDA_IDLE) {
+#ifdef XLDA_INT1_WIRED
+        if (xlda_drdy && i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, OUTX_L_G, (uint8_t *)&xlda_gxl, sizeof(xlda_gxl))) {
+            xlda_drdy = false;
+            xlda_phase = XLDA_DATA;
+        }
+#else
+        if (tmr_expired(xlda_due) && i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, OUTX_L_G, (uint8_t *)&xlda_gxl, sizeof(xlda_gxl))) {
+            xlda_due = tmr_now() + XLDA_SMP_TICKS;
+            xlda_phase = XLDA_DATA;
+        }
+#endif
+        return I2C_ACK;
+    }
+    if (!xlda_xfer.done)
+        return I2C_ACK;
+    xlda_phase = XLDA_IDLE;
+    if (xlda_xfer.status)
+        return xlda_xfer.status;
+    xlda_fuse();
+    xlda_valid = true;
+    xlda_stale = tmr_now() + XLDA_TMO_TICKS;
+#ifdef XLDA_INT1_WIRED
+    EX1 = 1; // Data-ready released by the read
+#endif
+    return I2C_ACK;
+}
+#elif defined(XLDA_INT1_WIRED)
+/**
+ * @brief Advance the background read of a sample
+ * @note Read only after a data-ready interrupt, copied to xlda_avg once complete
+ * @retval I2C_ACK unless the last transaction failed
+ */
+static i2c_status_t xlda_step(void)
+{
+    if (xlda_phase == XLDA_IDLE) {
+        if (xlda_drdy && i2c_memread_async(&xlda_xfer, LSM6DS_I2CADDR, OUTX_L_XL, (uint8_t *)&xlda_smp, sizeof(xlda_smp))) {
+            xlda_drdy = false;
+            xlda_phase = XLDA_DATA;
+        }
+        return I2C_ACK;
+    }
+    if (!xlda_xfer.done)
+        return I2C_ACK;
+    xlda_phase = XLDA_IDLE;
+    if (xlda_xfer.status)
+        return xlda_xfer.status;
+    xlda_avg = xlda_smp;
+    xlda_valid = true;
+    xlda_stale = tmr_now() + XLDA_TMO_TICKS;
+    EX1 = 1; // Data-ready released by the read
+    return I2C_ACK;
+}
+#else
+/**
+ * @brief Read the value of the three axes of the accelerometer
+ * @param pdata Pointer to xlda_out_t used for data reception
+ * @note STATUS_REG polled for XLDA_TMO_TICKS at most
+ * @retval I2C_ACK if data available, I2C_TIMEOUT if no sample came in time, the i2c_status_t
+ *         error otherwise
+ */
+i2c_status_t xlda_read(xlda_out_t *pdata)
+{
+    i2c_status_t status;
+    uint8_t sr;
+    tmr_t deadline = tmr_now() + XLDA_TMO_TICKS;
+    do {
+        status = i2c_memread(LSM6DS_I2CADDR, STATUS_REG, &sr, sizeof(sr));
+        if (status)
+            return status;
+        if (sr & SR_XLDA)
+            return i2c_memread(LSM6DS_I2CADDR, OUTX_L_XL, (uint8_t *)pdata, sizeof(*pdata));
+    } while (!tmr_expired(deadline));
+    return I2C_TIMEOUT;
+}
+#endif
+
+#if XLDA_BG
+/**
+ * @brief Hand over the latest sample/batch unless it is overdue
+ * @param pdata Pointer to xlda_out_t used for data reception
+ * @note  Once overdue, the next xlda_read() waits for fresh data again (XLDA_TMO_TICKS
+ *        at most) instead of returning stale values
+ * @retval I2C_ACK if data available, I2C_TIMEOUT otherwise
+ */
+static i2c_status_t xlda_take(xlda_out_t *pdata)
+{
+    if (tmr_expired(xlda_stale)) {
+        xlda_valid = false;
+        xlda_stale = tmr_now() + XLDA_TMO_TICKS;
+        return I2C_TIMEOUT;
+    }
+    *pdata = xlda_avg;
+    return I2C_ACK;
+}
+#endif
+
+#if XLDA_GYRO
+/**
+ * @brief Fuse the latest gyroscope/accelerometer sample into the tilt
+ * @note  Complementary filter on binary angles: the rates about Y and X are integrated
+ *        over the elapsed ticks, and the result pulled towards the accelerometer tilt
+ *        (atan2 of X and Y over Z) with a time constant of XLDA_CF_MS. Hand shake is
+ *        then seen through the gyroscope only. Board assumed face up
+ * @retval None
+ */
+static void xlda_fuse(void)
+{
+    tmr_t now = tmr_now(), dt = now - xlda_t;
+    int16_t ax = cordic_atan2(xlda_gxl.xl.x, xlda_gxl.xl.z);
+    int16_t ay = cordic_atan2(xlda_gxl.xl.y, xlda_gxl.xl.z);
+    xlda_t = now;
+    if (!xlda_fused || dt > XLDA_DT_MAX) {
+        xlda_tx = (int32_t)ax << 16;
+        xlda_ty = (int32_t)ay << 16;
+        xlda_fused = true;
+    } else {
+        xlda_tx -= (int32_t)xlda_gxl.g.y * dt * XLDA_G_K >> XLDA_G_SHIFT; // Tilting X down is a negative rate about Y
+        xlda_ty += (int32_t)xlda_gxl.g.x * dt * XLDA_G_K >> XLDA_G_SHIFT;
+        xlda_tx += (int32_t)(int16_t)(ax - (int16_t)(xlda_tx >> 16)) * dt * XLDA_CF_K; // Wrap-safe error
+        xlda_ty += (int32_t)(int16_t)(ay - (int16_t)(xlda_ty >> 16)) * dt * XLDA_CF_K;
+    }
+    xlda_avg.x = xlda_tilt(xlda_tx);
+    xlda_avg.y = xlda_tilt(xlda_ty);
+    xlda_avg.z = xlda_gxl.xl.z;
+}
+
+/**
+ * @brief  Scale a fused tilt to the accelerometer range
+ * @param  t Tilt (Q16 binary angle)
+ * @retval ±32767 at ±XLDA_TILT_DEG, saturated beyond
+ */
+static int16_t xlda_tilt(int32_t t)
+{
+    int32_t v = (int32_t)(int16_t)(t >> 16) * XLDA_TILT_K >> 8;
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    if (v < -INT16_MAX)
+        return -INT16_MAX;
+    return v;
+}
+#endif
+
+#ifdef XLDA_INT1_WIRED
+/**
+ * @brief Flag the data of the accelerometer as ready
+ * @note External Interrupt 1 Subroutine (level-triggered, masked here until xlda_read()
+ *       has read the data that released INT1)
+ * @retval None
+ */
+void xlda_isr(void) __interrupt(IE1_VECTOR)
+{
+    EX1 = 0;
+    xlda_drdy = true;
+}
+#endif
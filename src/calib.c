@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * @file    calib.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Sensor Calibration Software (persisted in Flash/EE data memory)
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "calib.h"
+#include "flashee.h"
+#include "joystick.h"
+#include "servo.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define CAL_JSTK_SPAN ((uint16_t)(CAL_MIN_SPAN * JSTK_RAW(256))) // Narrowest joystick sweep accepted
+#define CAL_LEVEL_MAX (INT16_MAX / 2) // Largest level readings accepted (half of the full scale)
+#define XLDA_HALF_X   ((XLDA_X_MAX - (int32_t)XLDA_X_MIN) / 2)
+#define XLDA_HALF_Y   ((XLDA_Y_MAX - (int32_t)XLDA_Y_MIN) / 2)
+#define OFS_BIN       0x8000U // int16_t to offset binary
+
+/* Private macros -------------------------------------------------------------*/
+#define ABS(A) ((A) < 0 ? -(A) : (A))
+
+/* Private typedefs/enums -----------------------------------------------------*/
+typedef struct {uint16_t min, span; uint32_t k;} cal_scale_t; // k = 2^32 / span
+
+/* Private functions' prototypes -----------------------------------------------*/
+static uint8_t cal_sum(const cal_rec_t *rec);
+static bool cal_valid(const cal_rec_t *rec);
+static void cal_apply(const cal_rec_t *rec);
+static void cal_level(cal_axis_t axis, int16_t level, int32_t half);
+static void cal_scale(cal_axis_t axis, uint16_t min, uint16_t max);
+
+/* Private variables ----------------------------------------------------------*/
+static cal_scale_t cal_tab[CAL_LY + 1];
+
+/**
+ * @brief Load the calibration record from Flash/EE, or the config.h limits if none is valid
+ * @note Scaling factors computed here, so cal_norm() needs no division. A record is
+ *       valid if its checksum matches and its values pass the checks of cal_save()
+ * @retval None
+ */
+void cal_load(void)
+{
+    cal_rec_t rec;
+    ee_read(CAL_EE_PAGE, (uint8_t *)&rec, sizeof(rec));
+    if (rec.ver != CAL_VERSION || cal_sum(&rec) || !cal_valid(&rec))
+        cal_defaults(&rec);
+    cal_apply(&rec);
+}
+
+/**
+ * @brief Fill a record with the limits of config.h
+ * @param rec Pointer to cal_rec_t to be filled
+ * @retval None
+ */
+void cal_defaults(cal_rec_t *rec)
+{
+    rec->ver = CAL_VERSION;
+    rec->jx_min = JSTK_RAW(JSTK_X_MIN);
+    rec->jx_max = JSTK_RAW(JSTK_X_MAX);
+    rec->jy_min = JSTK_RAW(JSTK_Y_MIN);
+    rec->jy_max = JSTK_RAW(JSTK_Y_MAX);
+    rec->lx = XLDA_X_MIN + XLDA_HALF_X;
+    rec->ly = XLDA_Y_MIN + XLDA_HALF_Y;
+}
+
+/**
+ * @brief Check, apply and store a calibration record
+ * @param rec Pointer to cal_rec_t with the measured values (version and checksum set here)
+ * @note Applied even if the Flash/EE write fails, for the current session only. One
+ *       page per frame, each in the gap after the servo pulses (see sv_gap), as the
+ *       core is halted while it is written
+ * @retval CAL_OK if stored, CAL_RANGE_ERR if a joystick sweep was too narrow or the
+ *         board not level, CAL_EE_ERR otherwise
+ */
+cal_status_t cal_save(cal_rec_t *rec)
+{
+    uint8_t i;
+    if (!cal_valid(rec))
+        return CAL_RANGE_ERR;
+    rec->ver = CAL_VERSION;
+    rec->sum = 0;
+    rec->sum = -cal_sum(rec);
+    cal_apply(rec);
+    for (i = 0; i < sizeof(*rec); i += EE_PAGE_SIZE) {
+        sv_gap();
+        if (ee_write(CAL_EE_PAGE + i / EE_PAGE_SIZE, (const uint8_t *)rec + i,
+                     sizeof(*rec) - i < EE_PAGE_SIZE ? sizeof(*rec) - i : EE_PAGE_SIZE))
+            return CAL_EE_ERR;
+    }
+    return CAL_OK;
+}
+
+/**
+ * @brief Normalize a raw reading over its calibrated range
+ * @param axis Calibrated axis
+ * @param raw Reading (jstk_out_t units, or offset binary for the accelerometer)
+ * @note Clamped to the range, one 32-bit multiplication otherwise
+ * @retval 0 to 65535 over the range (32768 at its center)
+ */
+uint16_t cal_norm(cal_axis_t axis, uint16_t raw)
+{
+    const cal_scale_t *s = &cal_tab[axis];
+    if (raw <= s->min)
+        return 0;
+    raw -= s->min;
+    if (raw >= s->span)
+        return UINT16_MAX;
+    return (uint32_t)raw * s->k >> 16;
+}
+
+/**
+ * @brief Two's complement checksum of a record
+ * @param rec Pointer to cal_rec_t
+ * @retval Sum of all bytes (0 for a valid record)
+ */
+static uint8_t cal_sum(const cal_rec_t *rec)
+{
+    const uint8_t *p = (const uint8_t *)rec;
+    uint8_t i, sum = 0;
+    for (i = 0; i < sizeof(*rec); i++)
+        sum += p[i];
+    return sum;
+}
+
+/**
+ * @brief Check the values of a record
+ * @param rec Pointer to cal_rec_t
+ * @retval True if both joystick sweeps are ordered and at least CAL_JSTK_SPAN wide and
+ *         both level readings within CAL_LEVEL_MAX
+ */
+static bool cal_valid(const cal_rec_t *rec)
+{
+    return rec->jx_max > rec->jx_min && rec->jx_max - rec->jx_min >= CAL_JSTK_SPAN &&
+           rec->jy_max > rec->jy_min && rec->jy_max - rec->jy_min >= CAL_JSTK_SPAN &&
+           ABS((int32_t)rec->lx) <= CAL_LEVEL_MAX && ABS((int32_t)rec->ly) <= CAL_LEVEL_MAX;
+}
+
+/**
+ * @brief Compute the scaling factors of a record
+ * @param rec Pointer to cal_rec_t
+ * @retval None
+ */
+static void cal_apply(const cal_rec_t *rec)
+{
+    cal_scale(CAL_JX, rec->jx_min, rec->jx_max);
+    cal_scale(CAL_JY, rec->jy_min, rec->jy_max);
+    cal_level(CAL_LX, rec->lx, XLDA_HALF_X);
+    cal_level(CAL_LY, rec->ly, XLDA_HALF_Y);
+}
+
+/**
+ * @brief Set the scaling factor of an accelerometer axis
+ * @param axis Calibrated axis
+ * @param level Reading with the board level (range center)
+ * @param half Half of the config.h range, narrowed if needed to stay within int16_t
+ * @retval None
+ */
+static void cal_level(cal_axis_t axis, int16_t level, int32_t half)
+{
+    int32_t room = INT16_MAX - ABS((int32_t)level);
+    if (half > room)
+        half = room;
+    cal_scale(axis, (uint16_t)(level - half) ^ OFS_BIN, (uint16_t)(level + half) ^ OFS_BIN);
+}
+
+/**
+ * @brief Set the scaling factor of an axis
+ * @param axis Calibrated axis
+ * @param min Raw reading mapped to 0
+ * @param max Raw reading mapped to 65535 (min < max required)
+ * @retval None
+ */
+static void cal_scale(cal_axis_t axis, uint16_t min, uint16_t max)
+{
+    cal_tab[axis].min = min;
+    cal_tab[axis].span = max - min;
+    cal_tab[axis].k = UINT32_MAX / (uint16_t)(max - min);
+}
@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    cordic.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   CORDIC and Integer Square Root Software
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "cordic.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define VEC_MAX   (1L << 14) // |x| + |y| bound of the vectoring inputs (grow by 1.647)
+#define INV_GAIN  19898      // 1 / 1.647 (Q15)
+#define ROT_START 9949       // 1 / 1.647 (Q14)
+
+/* Private macros -------------------------------------------------------------*/
+/* Unrolled so every shift is a literal: byte moves and a few RRCs, no shift loops */
+#define VEC_STEP(I) do {                                               \
+    if (y < 0) {t = x - (y >> I); y += x >> I; x = t; a -= atan_lut[I];} \
+    else       {t = x + (y >> I); y -= x >> I; x = t; a += atan_lut[I];} \
+} while (0)
+
+#define ROT_STEP(I) do {                                               \
+    if (z < 0) {t = x + (y >> I); y -= x >> I; x = t; z += atan_lut[I];} \
+    else       {t = x - (y >> I); y += x >> I; x = t; z -= atan_lut[I];} \
+} while (0)
+
+#define CORDIC_14_STEPS(STEP) do {                                      \
+    STEP(0); STEP(1); STEP(2); STEP(3); STEP(4); STEP(5); STEP(6);       \
+    STEP(7); STEP(8); STEP(9); STEP(10); STEP(11); STEP(12); STEP(13);   \
+} while (0)
+
+/* Private variables ----------------------------------------------------------*/
+static const int16_t __code atan_lut[] = { // atan(2^-i) as binary angles
+    8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+
+/* Private functions' prototypes ----------------------------------------------*/
+static bang_t cordic_vec(int32_t y, int32_t x, uint32_t *mag);
+
+/**
+ * @brief  Four-quadrant arctangent
+ * @param  y Ordinate (any fixed-point scale shared with x)
+ * @param  x Abscissa
+ * @retval Angle of (x,y), 0 if both are zero
+ */
+bang_t cordic_atan2(int32_t y, int32_t x)
+{
+    return cordic_vec(y, x, NULL);
+}
+
+/**
+ * @brief  Magnitude of a vector
+ * @param  y Ordinate
+ * @param  x Abscissa
+ * @note   Error below 2^-10 of the result plus one unit
+ * @retval sqrt(x^2 + y^2) in the same scale as x and y
+ */
+uint32_t cordic_hypot(int32_t y, int32_t x)
+{
+    uint32_t mag;
+    cordic_vec(y, x, &mag);
+    return mag;
+}
+
+/**
+ * @brief  Sine and cosine of a binary angle (rotation mode)
+ * @param  a Angle
+ * @param  s Pointer to the sine (Q14, CORDIC_1 = 1.0)
+ * @param  c Pointer to the cosine (Q14, CORDIC_1 = 1.0)
+ * @retval None
+ */
+void cordic_sincos(bang_t a, int16_t *s, int16_t *c)
+{
+    int16_t x = ROT_START, y = 0, t;
+    int16_t z = a;
+    bool flip = false;
+    if (z > (int16_t)(BANG_PI / 2) || z < -(int16_t)(BANG_PI / 2)) { // Rotate by PI
+        z += BANG_PI;
+        flip = true;
+    }
+    CORDIC_14_STEPS(ROT_STEP);
+    *s = flip ? -y : y;
+    *c = flip ? -x : x;
+}
+
+/**
+ * @brief  Integer square root (bitwise, one result bit per iteration)
+ * @param  n Radicand
+ * @retval floor(sqrt(n))
+ */
+uint16_t isqrt(uint32_t n)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > n)
+        bit >>= 2;
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * @brief  Vectoring mode: rotate (vx,vy) onto the positive x axis
+ * @param  vy Ordinate
+ * @param  vx Abscissa
+ * @param  mag Pointer to the resulting magnitude, NULL if not needed
+ * @note   Inputs (below 2^30) are normalized to |vx| + |vy| < VEC_MAX so the 16-bit
+ *         iterations cannot overflow
+ * @retval Accumulated rotation, i.e. the angle of (vx,vy)
+ */
+static bang_t cordic_vec(int32_t vy, int32_t vx, uint32_t *mag)
+{
+    bang_t a = 0;
+    int16_t x, y, t;
+    int8_t sh = 0;
+    int32_t sum;
+    if (vx < 0) { // Rotate by PI
+        vx = -vx;
+        vy = -vy;
+        a = BANG_PI;
+    }
+    sum = vy < 0 ? vx - vy : vx + vy;
+    if (!sum) {
+        if (mag)
+            *mag = 0;
+        return 0;
+    }
+    for (; sum >= VEC_MAX; sum >>= 1)
+        sh++;
+    for (; sum < VEC_MAX / 2; sum <<= 1)
+        sh--;
+    x = sh > 0 ? vx >> sh : vx << -sh;
+    y = sh > 0 ? vy >> sh : vy << -sh;
+    CORDIC_14_STEPS(VEC_STEP);
+    if (mag)
+        *mag = sh > 0 ? ((uint32_t)x * INV_GAIN >> 15) << sh : (uint32_t)x * INV_GAIN >> (15 - sh);
+    return a;
+}
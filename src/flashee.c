@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    flashee.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Flash/EE Data Memory Driver Software
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flashee.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define ECON_READ       0x01 // EDATA1..4 loaded from the page at EADRH/L
+#define ECON_PROGRAM    0x02 // EDATA1..4 programmed into the (erased) page
+#define ECON_VERIFY     0x04 // ECON reads 0 if the page matches EDATA1..4
+#define ECON_ERASE_PAGE 0x05
+#define ERASED_BYTE     0xFFU
+
+/**
+ * @brief Read consecutive bytes from Flash/EE data memory
+ * @param page First page to be read
+ * @param pdata Pointer to data buffer
+ * @param datalen Amount of data in bytes to be read
+ * @retval None
+ */
+void ee_read(uint16_t page, uint8_t *pdata, uint8_t datalen)
+{
+    uint8_t buf[EE_PAGE_SIZE], i;
+    for (; datalen; page++) {
+        EADRH = HIGHBYTE(page);
+        EADRL = LOWBYTE(page);
+        ECON = ECON_READ;
+        buf[0] = EDATA1;
+        buf[1] = EDATA2;
+        buf[2] = EDATA3;
+        buf[3] = EDATA4;
+        for (i = 0; i < EE_PAGE_SIZE && datalen; i++, datalen--)
+            *pdata++ = buf[i];
+    }
+}
+
+/**
+ * @brief Erase, program and verify consecutive pages of Flash/EE data memory
+ * @param page First page to be written
+ * @param pdata Pointer to data buffer
+ * @param datalen Amount of data in bytes to be written (last page padded as erased)
+ * @note The core is halted during each command (up to 2 ms for a page erase), which
+ *       delays pending interrupts: the servo ISR too, so callers write one page at a
+ *       time in sv_gap()
+ * @retval EE_OK if every page was verified, EE_ERR otherwise
+ */
+ee_status_t ee_write(uint16_t page, const uint8_t *pdata, uint8_t datalen)
+{
+    uint8_t buf[EE_PAGE_SIZE], i;
+    for (; datalen; page++) {
+        for (i = 0; i < EE_PAGE_SIZE; i++)
+            buf[i] = ERASED_BYTE;
+        for (i = 0; i < EE_PAGE_SIZE && datalen; i++, datalen--)
+            buf[i] = *pdata++;
+        EADRH = HIGHBYTE(page);
+        EADRL = LOWBYTE(page);
+        ECON = ECON_ERASE_PAGE;
+        EDATA1 = buf[0];
+        EDATA2 = buf[1];
+        EDATA3 = buf[2];
+        EDATA4 = buf[3];
+        ECON = ECON_PROGRAM;
+        ECON = ECON_VERIFY;
+        if (ECON)
+            return EE_ERR;
+    }
+    return EE_OK;
+}
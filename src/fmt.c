@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @file    fmt.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Float-free Numeric Formatting Software
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "fmt.h"
+
+/* Private variables ----------------------------------------------------------*/
+static const uint16_t __code pow10_lut[] = {10000, 1000, 100, 10};
+
+/**
+ * @brief  Render an unsigned integer as a null-terminated string
+ * @param  s Destination buffer of at least FMT_U16_LEN characters
+ * @param  val Unsigned integer to be rendered
+ * @note   Digits by repeated subtraction of powers of ten (at most 9 per digit),
+ *         no 16-bit division
+ * @retval Number of characters written (terminator excluded)
+ */
+uint8_t fmt_u16(char *s, uint16_t val)
+{
+    uint8_t i, n = 0;
+    char d;
+    for (i = 0; i < ARR_SIZE(pow10_lut); i++) {
+        for (d = '0'; val >= pow10_lut[i]; d++)
+            val -= pow10_lut[i];
+        if (n || d != '0') // Skip leading zeros
+            s[n++] = d;
+    }
+    s[n++] = (char)val + '0';
+    s[n] = '\0';
+    return n;
+}
+
+/**
+ * @brief  Render a signed integer as a null-terminated string
+ * @param  s Destination buffer of at least FMT_I16_LEN characters
+ * @param  val Signed integer to be rendered
+ * @retval Number of characters written (terminator excluded)
+ */
+uint8_t fmt_i16(char *s, int16_t val)
+{
+    if (val < 0) {
+        *s = '-';
+        return fmt_u16(s + 1, -(uint16_t)val) + 1; // INT_MIN handled properly
+    }
+    return fmt_u16(s, val);
+}
+
+/**
+ * @brief  Render a Q8 fixed-point value with 2 decimal places as a null-terminated string
+ * @param  s Destination buffer of at least FMT_Q8_LEN characters
+ * @param  val Q8 value to be rendered (e.g. point_t coordinates)
+ * @note   Hundredths rounded from the fraction byte with a single MUL AB
+ * @retval Number of characters written (terminator excluded)
+ */
+uint8_t fmt_q8(char *s, int16_t val)
+{
+    uint8_t n = 0, f;
+    uint16_t u = val;
+    if (val < 0) {
+        s[n++] = '-';
+        u = -u;
+    }
+    f = HIGHBYTE((uint16_t)(LOWBYTE(u) * (uint8_t)100) + 0x80);
+    if (f == 100) { // Rounded up to the next unit
+        f = 0;
+        u += 0x100;
+    }
+    n += fmt_u16(s + n, HIGHBYTE(u));
+    s[n++] = '.';
+    s[n] = '0';
+    while (f >= 10) {
+        f -= 10;
+        s[n]++;
+    }
+    s[++n] = (char)f + '0';
+    s[++n] = '\0';
+    return n;
+}
@@ -9,36 +9,108 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
 #include "i2c.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define TX_MODE    1
 #define RX_MODE    0
-#define BYTE_BIT   8
 #define I2CCON_ON  0xA8 // Set I2CM and enter IDLE state
 #define SPICON_OFF 0x00
+#define I2C_MC_NS  (954L << (PLLCON_INIT_VAL & PLLCON_CD_MASK)) // Machine cycle (ns), signed integer for #if
+
+#if I2C_SPEED_HZ == 100000
+#define I2C_T_HIGH 4000 // ns, min SCL high time (also tHD;STA and tSU;STO)
+#define I2C_T_LOW  4700 // ns, min SCL low time (also tSU;STA and tBUF)
+#elif I2C_SPEED_HZ == 400000
+#define I2C_T_HIGH 600
+#define I2C_T_LOW  1300
+#else
+#error "I2C_SPEED_HZ must be 100000 or 400000"
+#endif
+
+#define I2C_MC(NS)     (((NS) + I2C_MC_NS - 1) / I2C_MC_NS) // Whole machine cycles covering NS
+#define I2C_HIGH_NOPS  (I2C_MC(I2C_T_HIGH) - 1) // SETB/CLR MCO itself takes one cycle
+#define I2C_LOW_NOPS   (I2C_MC(I2C_T_LOW) - 1)
+#define I2C_SETUP_NOPS (I2C_MC(I2C_T_LOW) - 3)  // Low phase already spent loading MDO (MOV A,Rn/MOV C,bit/MOV bit,C)
 
 /* Private macros -------------------------------------------------------------*/
 #define I2C_WR(ADDR) ((ADDR) << 1)
 #define I2C_RD(ADDR) (((ADDR) << 1) | 1U)
 
-/* Private inline functions' definitions ---------------------------------------*/
-inline void i2c_delay(void) { NOP(); NOP(); NOP(); } // Depends on I2C mode and core frequency
-inline void i2c_pulse(void) { MCO = 1; i2c_delay(); MCO = 0; }
+#define I2C_NOPS_0()
+#define I2C_NOPS_1() NOP()
+#define I2C_NOPS_2() NOP(); NOP()
+#define I2C_NOPS_3() NOP(); NOP(); NOP()
+#define I2C_NOPS_4() NOP(); NOP(); NOP(); NOP()
+
+#if I2C_HIGH_NOPS > 4 || I2C_LOW_NOPS > 4
+#error "I2C bit timing needs more NOPs than I2C_NOPS_x provides"
+#endif
+
+#if I2C_HIGH_NOPS <= 0
+#define I2C_WAIT_HIGH() I2C_NOPS_0()
+#elif I2C_HIGH_NOPS == 1
+#define I2C_WAIT_HIGH() I2C_NOPS_1()
+#elif I2C_HIGH_NOPS == 2
+#define I2C_WAIT_HIGH() I2C_NOPS_2()
+#elif I2C_HIGH_NOPS == 3
+#define I2C_WAIT_HIGH() I2C_NOPS_3()
+#else
+#define I2C_WAIT_HIGH() I2C_NOPS_4()
+#endif
+
+#if I2C_LOW_NOPS <= 0
+#define I2C_WAIT_LOW() I2C_NOPS_0()
+#elif I2C_LOW_NOPS == 1
+#define I2C_WAIT_LOW() I2C_NOPS_1()
+#elif I2C_LOW_NOPS == 2
+#define I2C_WAIT_LOW() I2C_NOPS_2()
+#elif I2C_LOW_NOPS == 3
+#define I2C_WAIT_LOW() I2C_NOPS_3()
+#else
+#define I2C_WAIT_LOW() I2C_NOPS_4()
+#endif
+
+#if I2C_SETUP_NOPS <= 0
+#define I2C_WAIT_SETUP() I2C_NOPS_0()
+#elif I2C_SETUP_NOPS == 1
+#define I2C_WAIT_SETUP() I2C_NOPS_1()
+#elif I2C_SETUP_NOPS == 2
+#define I2C_WAIT_SETUP() I2C_NOPS_2()
+#elif I2C_SETUP_NOPS == 3
+#define I2C_WAIT_SETUP() I2C_NOPS_3()
+#else
+#define I2C_WAIT_SETUP() I2C_NOPS_4()
+#endif
+
+/* One SCL period per bit, no calls: data is driven while SCL is low and sampled while it is high */
+#define I2C_TX_BIT(MASK) do { MDO = (byte & (MASK)) != 0; I2C_WAIT_SETUP(); MCO = 1; I2C_WAIT_HIGH(); MCO = 0; } while (0)
+#define I2C_RX_BIT(MASK) do { I2C_WAIT_LOW(); MCO = 1; I2C_WAIT_HIGH(); if (MDI) byte |= (MASK); MCO = 0; } while (0)
+
+/* Private typedefs/enums -----------------------------------------------------*/
+enum {I2C_PH_ADDR, I2C_PH_REG, I2C_PH_RADDR, I2C_PH_DATA}; // i2c_xfer_t.phase, next byte on the bus
+
+/* Private variables ----------------------------------------------------------*/
+static i2c_xfer_t *i2c_cur; // Transaction run by i2c_poll(), NULL if none
 
 /* Private functions' prototypes -----------------------------------------------*/
-static void i2c_start(void);
+static void i2c_step(i2c_xfer_t *x);
+static void i2c_drain(void);
+static i2c_status_t i2c_start(void);
 static void i2c_stop(void);
 static i2c_status_t i2c_sendbyte(uint8_t byte);
 static uint8_t i2c_receivebyte(i2c_status_t reply_bit);
 
 /**
  * @brief Initialization of the I2C interface
- * @note The I2C and SPI modules may only be used one at a time
+ * @note The I2C and SPI modules may only be used one at a time. A transaction
+ *       in flight is completed first
  * @retval None
  */
 void i2c_init(void)
 {
+    i2c_drain();
     SPICON = SPICON_OFF;
     I2CCON = I2CCON_ON;
 }
@@ -50,15 +122,19 @@ void i2c_init(void)
  * @param  pdata Pointer to data buffer
  * @param  datalen Amount of data in bytes to be sent
  * @note   Set devaddr's MSB to ignore memaddr and write data directly to device
- * @retval I2C_ACK if successful, I2C_NACK otherwise
+ * @note   The master owns SCL (no clock stretching), so the transaction lasts a bounded
+ *         number of bit periods set by datalen
+ * @retval I2C_ACK if successful, I2C_NACK if not acknowledged, I2C_BUS_ERR if SDA is held low
  */
 i2c_status_t i2c_memwrite(uint8_t devaddr, uint8_t memaddr, const uint8_t *pdata, uint8_t datalen)
 {
-    i2c_start();
+    i2c_drain();
+    if (i2c_start())
+        return I2C_BUS_ERR;
     if (!i2c_sendbyte(I2C_WR(devaddr)) && (devaddr & BYTE_MSB_MASK || !i2c_sendbyte(memaddr)))
         for (; datalen && !i2c_sendbyte(*pdata++); datalen--);
     i2c_stop();
-    return datalen;
+    return datalen ? I2C_NACK : I2C_ACK;
 }
 
 /**
@@ -68,87 +144,225 @@ i2c_status_t i2c_memwrite(uint8_t devaddr, uint8_t memaddr, const uint8_t *pdata
  * @param  pdata Pointer to data buffer
  * @param  datalen Amount of data in bytes to be read
  * @note   Set devaddr's MSB to ignore memaddr and read data directly from device
- * @retval I2C_ACK if successful, I2C_NACK otherwise
+ * @note   The master owns SCL (no clock stretching), so the transaction lasts a bounded
+ *         number of bit periods set by datalen
+ * @retval I2C_ACK if successful, I2C_NACK if not acknowledged, I2C_BUS_ERR if SDA is held low
  */
 i2c_status_t i2c_memread(uint8_t devaddr, uint8_t memaddr, uint8_t *pdata, uint8_t datalen)
 {
-    i2c_start();
+    i2c_drain();
+    if (i2c_start())
+        return I2C_BUS_ERR;
     if (!(devaddr & BYTE_MSB_MASK)) {
         if (i2c_sendbyte(I2C_WR(devaddr)) || i2c_sendbyte(memaddr))
             goto clean_up;
-        i2c_start(); // Repeated start
+        if (i2c_start()) // Repeated start
+            return I2C_BUS_ERR;
     }
     if (!i2c_sendbyte(I2C_RD(devaddr)))
         for (; datalen; datalen--)
             *pdata++ = i2c_receivebyte(datalen == 1); // End w/NACK
   clean_up:
     i2c_stop();
-    return datalen;
+    return datalen ? I2C_NACK : I2C_ACK;
+}
+
+/**
+ * @brief  Queue a transaction to be run by i2c_poll()
+ * @param  xfer Pointer to the i2c_xfer_t describing it (devaddr, memaddr, pdata, datalen, rd),
+ *         to be left untouched until done is set
+ * @note   Only one transaction in flight, i2c_memread()/i2c_memwrite() complete it first
+ * @retval True if accepted, false if another transaction is in flight
+ */
+bool i2c_submit(i2c_xfer_t *xfer)
+{
+    if (i2c_cur)
+        return false;
+    xfer->phase = I2C_PH_ADDR;
+    xfer->done = false;
+    i2c_cur = xfer;
+    return true;
 }
 
 /**
- * @brief Execute the "Start" sequence of the I2C protocol
+ * @brief Advance the transaction in flight by up to I2C_POLL_BYTES bytes
+ * @note  To be called from the main loop: bus time is then spread over the
+ *        iterations, which keep running while a transaction is in flight
  * @retval None
  */
-static void i2c_start(void)
+void i2c_poll(void)
 {
-    MDE = TX_MODE;
-    MDO = 1;
+    uint8_t n = I2C_POLL_BYTES;
+    while (i2c_cur && n--) {
+        i2c_step(i2c_cur);
+        if (i2c_cur->done)
+            i2c_cur = NULL;
+    }
+}
+
+/**
+ * @brief Free a bus whose SDA is held low by a slave stuck in the middle of a byte
+ * @note  Up to I2C_RECOVER_CLOCKS SCL pulses with SDA released, until the slave lets
+ *        it go (it then sees a NACK), followed by a "Stop"
+ * @retval I2C_ACK if SDA is released, I2C_BUS_ERR otherwise
+ */
+i2c_status_t i2c_recover(void)
+{
+    uint8_t n = I2C_RECOVER_CLOCKS;
+    MDE = RX_MODE;
+    do {
+        MCO = 0;
+        I2C_WAIT_LOW();
+        MCO = 1;
+        I2C_WAIT_HIGH();
+    } while (!MDI && --n);
+    MCO = 0;
+    i2c_stop();
+    MDE = RX_MODE;
+    return MDI ? I2C_ACK : I2C_BUS_ERR;
+}
+
+/**
+ * @brief Clock the next byte of a transaction (address, memory address or data)
+ * @param x Pointer to the i2c_xfer_t in flight
+ * @note  Same sequence as i2c_memread()/i2c_memwrite(), done and status set after the "Stop"
+ * @retval None
+ */
+static void i2c_step(i2c_xfer_t *x)
+{
+    i2c_status_t nack = I2C_ACK;
+    switch (x->phase) {
+    case I2C_PH_ADDR:
+    case I2C_PH_RADDR:
+        if (i2c_start()) {
+            x->status = I2C_BUS_ERR;
+            x->done = true;
+            return;
+        }
+        if (x->phase == I2C_PH_ADDR && !(x->devaddr & BYTE_MSB_MASK)) {
+            nack = i2c_sendbyte(I2C_WR(x->devaddr));
+            x->phase = I2C_PH_REG;
+        } else {
+            nack = i2c_sendbyte(x->rd ? I2C_RD(x->devaddr) : I2C_WR(x->devaddr));
+            x->phase = I2C_PH_DATA;
+        }
+        break;
+    case I2C_PH_REG:
+        nack = i2c_sendbyte(x->memaddr);
+        x->phase = x->rd ? I2C_PH_RADDR : I2C_PH_DATA; // Repeated start to read
+        break;
+    default:
+        if (x->rd)
+            *x->pdata++ = i2c_receivebyte(x->datalen == 1); // End w/NACK
+        else
+            nack = i2c_sendbyte(*x->pdata++);
+        if (!nack)
+            x->datalen--;
+    }
+    if (nack || (x->phase == I2C_PH_DATA && !x->datalen)) {
+        i2c_stop();
+        x->status = nack ? I2C_NACK : I2C_ACK;
+        x->done = true;
+    }
+}
+
+/**
+ * @brief Complete the transaction in flight, if any, before a blocking one
+ * @retval None
+ */
+static void i2c_drain(void)
+{
+    while (i2c_cur)
+        i2c_poll();
+}
+
+/**
+ * @brief Execute the "Start" (or repeated "Start") sequence of the I2C protocol
+ * @note  Entered with SCL low (repeated start) or with the bus idle. SDA is released
+ *        and checked high first, the bus being recovered otherwise
+ * @retval I2C_ACK if the bus was free, I2C_BUS_ERR if SDA could not be released
+ */
+static i2c_status_t i2c_start(void)
+{
+    MDE = RX_MODE;
+    I2C_WAIT_LOW();
     MCO = 1;
-    i2c_delay();
+    I2C_WAIT_LOW();  // tSU;STA
+    if (!MDI && i2c_recover())
+        return I2C_BUS_ERR;
+    MDO = 1;
+    MDE = TX_MODE;
     MDO = 0;
-    i2c_delay();
+    I2C_WAIT_HIGH(); // tHD;STA
     MCO = 0;
+    return I2C_ACK;
 }
 
 /**
  * @brief Execute the "Stop" sequence of the I2C protocol
+ * @note  Leaves the bus free for tBUF before returning
  * @retval None
  */
 static void i2c_stop(void)
 {
     MDE = TX_MODE;
     MDO = 0;
-    i2c_delay();
+    I2C_WAIT_LOW();
     MCO = 1;
-    i2c_delay();
+    I2C_WAIT_HIGH(); // tSU;STO
     MDO = 1;
+    I2C_WAIT_LOW();  // tBUF
 }
 
 /**
- * @brief  Send a byte bit-by-bit over the I2C interface
+ * @brief  Send a byte over the I2C interface (unrolled, one SCL period per bit)
  * @param  byte Payload to be sent
- * @retval ACK/NACK read from the I2C interface after last data bit
+ * @retval ACK/NACK sampled while SCL is high on the ninth clock
  */
 static i2c_status_t i2c_sendbyte(uint8_t byte)
 {
-    uint8_t bit_mask = BYTE_MSB_MASK;
+    i2c_status_t ack;
     MDE = TX_MODE;
-    do {
-        MDO = byte & bit_mask;
-        i2c_pulse();
-    } while (bit_mask >>= 1);
+    I2C_TX_BIT(0x80);
+    I2C_TX_BIT(0x40);
+    I2C_TX_BIT(0x20);
+    I2C_TX_BIT(0x10);
+    I2C_TX_BIT(0x08);
+    I2C_TX_BIT(0x04);
+    I2C_TX_BIT(0x02);
+    I2C_TX_BIT(0x01);
     MDE = RX_MODE;
-    i2c_pulse();
-    return MDI;
+    I2C_WAIT_LOW();
+    MCO = 1;
+    I2C_WAIT_HIGH();
+    ack = MDI;
+    MCO = 0;
+    return ack;
 }
 
 /**
- * @brief  Read a byte bit-by-bit over the I2C interface
+ * @brief  Read a byte over the I2C interface (unrolled, one SCL period per bit)
  * @param  reply_bit Reply bit to be sent after last data bit
+ * @note   Bits are sampled while SCL is high, the slave may change SDA right after SCL falls
  * @retval Byte read from the I2C interface
  */
 static uint8_t i2c_receivebyte(i2c_status_t reply_bit)
 {
     uint8_t byte = 0x00;
-    uint8_t bit_cnt = BYTE_BIT;
     MDE = RX_MODE;
-    do {
-        i2c_pulse();
-        byte = (byte << 1) | MDI;
-    } while (--bit_cnt);
+    I2C_RX_BIT(0x80);
+    I2C_RX_BIT(0x40);
+    I2C_RX_BIT(0x20);
+    I2C_RX_BIT(0x10);
+    I2C_RX_BIT(0x08);
+    I2C_RX_BIT(0x04);
+    I2C_RX_BIT(0x02);
+    I2C_RX_BIT(0x01);
     MDE = TX_MODE;
     MDO = reply_bit;
-    i2c_pulse();
+    I2C_WAIT_SETUP();
+    MCO = 1;
+    I2C_WAIT_HIGH();
+    MCO = 0;
     return byte;
 }
\ No newline at end of file
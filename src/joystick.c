@@ -11,31 +11,140 @@
 /* Includes ------------------------------------------------------------------*/
 #include "joystick.h"
 
+/* Private defines -----------------------------------------------------------*/
+#define JSTK_GOT_X 0x01U
+#define JSTK_GOT_Y 0x02U
+
+/* Private typedefs/enums -----------------------------------------------------*/
+#if JSTK_HIRES
+typedef struct {jstk_raw_t x, y; uint16_t noise; _Bool err;} jstk_smp_t;
+#else
+typedef struct {jstk_raw_t x, y; _Bool err;} jstk_smp_t;
+#endif
+
+/* Private variables ----------------------------------------------------------*/
+static jstk_smp_t jstk_buf[2];     // Published pair at jstk_seq's parity, the other one is filled
+static volatile uint8_t jstk_seq;  // Pairs published by jstk_isr() (wraps)
+static uint8_t jstk_got;           // JSTK_GOT_X/Y of the pair being filled
+#if JSTK_HIRES
+static uint32_t jstk_avg[2];       // Exponential average times 2^JSTK_FILT_SHIFT (x, y)
+static uint32_t jstk_dev[2];       // Mean absolute deviation times 2^JSTK_FILT_SHIFT (x, y)
+static bool jstk_prime;            // Seed the filters with the next sample
+#endif
+
+#if JSTK_HIRES
+#pragma save
+#pragma nooverlay
+/**
+ * @brief Run one axis' decimation filter on a new conversion
+ * @param i Axis (0 for x, 1 for y)
+ * @param s Conversion result (16-bit)
+ * @note Called from jstk_isr() only. First order IIR of 2^JSTK_FILT_SHIFT samples
+ *       (shifts and adds only), noise as the same average of |s - output|
+ * @retval Filter output
+ */
+static uint16_t jstk_filt(uint8_t i, uint16_t s)
+{
+    uint16_t out;
+    if (jstk_prime) {
+        jstk_avg[i] = (uint32_t)s << JSTK_FILT_SHIFT;
+        jstk_dev[i] = 0;
+    }
+    jstk_avg[i] = jstk_avg[i] - (jstk_avg[i] >> JSTK_FILT_SHIFT) + s;
+    out = jstk_avg[i] >> JSTK_FILT_SHIFT;
+    jstk_dev[i] = jstk_dev[i] - (jstk_dev[i] >> JSTK_FILT_SHIFT) + (s > out ? s - out : out - s);
+    return out;
+}
+#pragma restore
+#endif
+
 /**
  * @brief Initialization of the ADCs connected to the joystick
+ * @note Waits for the first pair of conversions, so jstk_read() never returns stale data
  * @retval None
  */
 void jstk_init(void)
 {
+    uint8_t seq = jstk_seq;
+    jstk_got = 0;
+#if JSTK_HIRES
+    jstk_prime = true;
+#endif
     ADC0CON = JSTK_ADC0CON_VAL;
     ADC1CON = JSTK_ADC1CON_VAL;
     SF = JSTK_SF_VAL;
+    RDY0 = 0;
+    RDY1 = 0;
+    EADC = 1;
+    EA = 1;
     ADCMODE = JSTK_ADCMODE_VAL;
+    while (jstk_seq == seq);
 }
 
 /**
- * @brief Read the values of the two axes of the joystick
+ * @brief Read the latest values of the two axes of the joystick
  * @param pdata Pointer to jstk_out_t used for data reception
- * @note ADC0 and ADC1 assumed to be connected to x-axis and y-axis respectively
- * @retval ADC_OK if both ADC readings were successful, ADC_ERR otherwise
+ * @note Constant time, no waiting for a conversion. pdata->seq tells fresh samples apart
+ * @retval ADC_OK if both ADC readings of the sample were successful, ADC_ERR otherwise
  */
 adc_status_t jstk_read(jstk_out_t *pdata)
 {
-    RDY0 = 0;
-    RDY1 = 0;
-    while (!RDY0);
-    pdata->x = ADC0H;
-    while (!RDY1);
-    pdata->y = ADC1H;
-    return ERR0 | ERR1;
-}
\ No newline at end of file
+    uint8_t seq;
+    bool err;
+    do { // x, y, noise and err of one pair, retried on any publish meanwhile
+        seq = jstk_seq;
+        pdata->x = jstk_buf[seq & 1].x;
+        pdata->y = jstk_buf[seq & 1].y;
+#if JSTK_HIRES
+        pdata->noise = jstk_buf[seq & 1].noise;
+#endif
+        err = jstk_buf[seq & 1].err;
+    } while (seq != jstk_seq);
+    pdata->seq = seq;
+    return err;
+}
+
+/**
+ * @brief Capture each conversion into the back buffer, published once both axes arrived
+ * @note ADC Interrupt Subroutine (RDY0/RDY1 cleared by software). ADC0 and ADC1
+ *       assumed to be connected to x-axis and y-axis respectively. With JSTK_HIRES,
+ *       the upper 16 bits of each result go through jstk_filt() and the noise of the
+ *       noisier axis is published with the pair
+ * @retval None
+ */
+void jstk_isr(void) __interrupt(RDY0_VECTOR)
+{
+    jstk_smp_t *back = &jstk_buf[(jstk_seq + 1) & 1];
+    if (RDY0) {
+        if (!jstk_got)
+            back->err = false;
+#if JSTK_HIRES
+        back->x = jstk_filt(0, (uint16_t)ADC0H << 8 | ADC0M);
+#else
+        back->x = ADC0H;
+#endif
+        back->err |= ERR0;
+        jstk_got |= JSTK_GOT_X;
+        RDY0 = 0;
+    }
+    if (RDY1) {
+        if (!jstk_got)
+            back->err = false;
+#if JSTK_HIRES
+        back->y = jstk_filt(1, (uint16_t)ADC1H << 8 | ADC1L);
+#else
+        back->y = ADC1H;
+#endif
+        back->err |= ERR1;
+        jstk_got |= JSTK_GOT_Y;
+        RDY1 = 0;
+    }
+    if (jstk_got == (JSTK_GOT_X | JSTK_GOT_Y)) {
+        jstk_got = 0;
+#if JSTK_HIRES
+        back->noise = (jstk_dev[0] > jstk_dev[1] ? jstk_dev[0] : jstk_dev[1]) >> JSTK_FILT_SHIFT;
+        jstk_prime = false;
+#endif
+        jstk_seq++;
+    }
+}
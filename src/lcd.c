@@ -10,92 +10,276 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "lcd.h"
+#include "timer.h"
+#include "fmt.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define HIGH_NIB_MASK 0xF0U
-#define LOG10_256     2.40823996531
 
-#define LCD_POWER_ON_DELAY_MS 40 // 5V:15mS 3.3V:40mS
-#define LCD_FUNC_SET_DELAY_MS 5  // 4.1mS
-#define LCD_MAX_BUSY_DELAY_MS 2  // 1.52mS
-#define LCD_REWRITE_DELAY_MS  1  // 100uS
+#define LCD_POWER_ON_DELAY_MS 40   // 5V:15mS 3.3V:40mS
+#define LCD_FUNC_SET_DELAY_MS 4.1
+#define LCD_MAX_BUSY_DELAY_MS 1.52
+#define LCD_REWRITE_DELAY_MS  0.1
+
+#define LCD_SLOW_EXEC_MC US_TO_MC(LCD_MAX_BUSY_DELAY_MS * 1e3) // LCD_CLEAR and LCD_RETHOME
+#define LCD_FAST_EXEC_MC US_TO_MC(LCD_REWRITE_DELAY_MS * 1e3)  // Everything else
+#define LCD_POLL_MC      US_TO_MC(40)                          // Busy flag period (typical execution time)
+#define LCD_BF_MASK      0x80U                                 // D7 while reading the address counter
+
+#define LCD_LINES        2                         // DDRAM lines, each shown as two rows
+#define LCD_LINE_LEN     (2 * LCD_COLUMNS_PER_ROW) // Shown cells of a DDRAM line
+#define LCD_LINE2_ADDR   0x40                      // DDRAM address of LCD_ROWTWO
+#define LCD_DDRAM_CMD    0x80                      // Set DDRAM address command
+#define LCD_DCB_MASK     0xF8                      // Display-Cursor-Blink command bits
+#define LCD_CB_MASK      0x03                      // Cursor and blink bits of it
+#define LCD_AC_UNKNOWN   0xFF
+
+#define LCD_Q_LEN  64 // Bytes queued for the TMR1 ISR (power of 2)
+#define LCD_Q_MASK (LCD_Q_LEN - 1)
+
+/* Private macros ------------------------------------------------------------*/
+#define TMR1_LOAD(MC) do {TH1 = HIGHBYTE(-(MC)); TL1 = LOWBYTE(-(MC));} while (0)
+
+/* Private typedefs/enums ----------------------------------------------------*/
+enum {LCD_Q_DATA, LCD_Q_CMD, LCD_Q_SLOW_CMD}; // Kinds of queued bytes (RS and execution time)
 
 /* Private inline functions' definitions ---------------------------------------*/
 inline uint8_t swap_nibs(uint8_t a) { return a >> 4 | a << 4; } // Compiler uses SWAP opcode
 
-/* Imported functions' prototypes ---------------------------------------------*/
-extern void delay_ms(uint16_t ms_cnt);
+/**
+ * @brief  Write to the four most significant bits of the LCD's data port
+ * @param  byte Byte containing the four most significant bits to be written
+ * @retval None
+ */
+inline void lcd_4b_wrt(uint8_t byte)
+{
+    LCD_E_SBIT = 1;
+    PORT_LCD_D &= ~HIGH_NIB_MASK;
+    PORT_LCD_D |= byte & HIGH_NIB_MASK;
+    LCD_E_SBIT = 0;
+}
+
+#ifdef LCD_RW_SBIT
+/**
+ * @brief  Read the busy flag (and discard the address counter)
+ * @note   Data pins released as inputs by writing ones to them
+ * @retval True if the LCD is still executing the last byte, false otherwise
+ */
+inline bool lcd_busy(void)
+{
+    bool bf;
+    PORT_LCD_D |= HIGH_NIB_MASK;
+    LCD_RS_SBIT = 0;
+    LCD_RW_SBIT = 1;
+    LCD_E_SBIT = 1;
+    bf = (PORT_LCD_D & LCD_BF_MASK) != 0;
+    LCD_E_SBIT = 0;
+    LCD_E_SBIT = 1; // Low nibble
+    LCD_E_SBIT = 0;
+    LCD_RW_SBIT = 0;
+    return bf;
+}
+#endif
+
+/* Private variables ----------------------------------------------------------*/
+static __xdata uint8_t lcd_qbyte[LCD_Q_LEN], lcd_qkind[LCD_Q_LEN]; // SPSC ring, lcd_push() to lcd_isr()
+static volatile uint8_t lcd_qhead, lcd_qtail;          // Free running, only written by lcd_push() / lcd_isr()
+
+static __xdata char lcd_fb[LCD_LINES][LCD_LINE_LEN];   // DDRAM contents as written by the application
+static __xdata char lcd_shown[LCD_LINES][LCD_LINE_LEN]; // DDRAM contents queued for the display
+static uint8_t lcd_line, lcd_col;                      // Writers' cursor
+static uint8_t lcd_dirty;                              // Lines of lcd_fb with changes (1 << line)
+static uint8_t lcd_ac = LCD_AC_UNKNOWN;                // LCD's address counter once the queue is sent
+static bool lcd_cursor;                                // Cursor or blink on, kept at the writers' cursor
 
 /* Private functions' prototypes ----------------------------------------------*/
-static void lcd_4b_wrt(uint8_t byte);
+static uint8_t lcd_room(void);
+static bool lcd_push(uint8_t byte, uint8_t kind);
 
 /**
  * @brief Initialize the LCD
+ * @note TMR1 to be reserved for pacing the output queue
  * @retval None
  */
 void lcd_init(void)
 {
-    delay_ms(LCD_POWER_ON_DELAY_MS);
+    tmr_wait(TMR_MS(LCD_POWER_ON_DELAY_MS));
 
+#ifdef LCD_RW_SBIT
+    LCD_RW_SBIT = 0;
+#endif
     LCD_RS_SBIT = 0;
     lcd_4b_wrt(LCD_8BIT1LX8);
-    delay_ms(LCD_FUNC_SET_DELAY_MS);
+    tmr_wait(TMR_MS(LCD_FUNC_SET_DELAY_MS));
 
     LCD_E_SBIT = 1;
     LCD_E_SBIT = 0;
-    delay_ms(LCD_REWRITE_DELAY_MS);
+    tmr_wait(TMR_MS(LCD_REWRITE_DELAY_MS));
 
     LCD_E_SBIT = 1;
     LCD_E_SBIT = 0;
-    delay_ms(LCD_REWRITE_DELAY_MS);
+    tmr_wait(TMR_MS(LCD_REWRITE_DELAY_MS));
 
     lcd_4b_wrt(LCD_4BIT1LX8);
-    delay_ms(LCD_REWRITE_DELAY_MS);
+    tmr_wait(TMR_MS(LCD_REWRITE_DELAY_MS));
+
+    TR1 = 0;
+    TMOD = (TMOD & 0x0F) | M0_1; // 16-bit, reloaded by lcd_isr()
+    EA = 1;
+    ET1 = 1;
 
     lcd_cmd(LCD_4BIT2LX8);
     lcd_cmd(LCD_DCBOFF);
-    lcd_cmd(LCD_CLEAR);
+    lcd_push(LCD_CLEAR, LCD_Q_SLOW_CMD);
+    lcd_ac = 0;
+    for (lcd_line = 0; lcd_line < LCD_LINES; lcd_line++)
+        for (lcd_col = 0; lcd_col < LCD_LINE_LEN; lcd_col++)
+            lcd_fb[lcd_line][lcd_col] = lcd_shown[lcd_line][lcd_col] = ' ';
+    lcd_line = lcd_col = 0;
     lcd_cmd(LCD_CINC);
     lcd_cmd(LCD_DONCBOFF);
 }
 
 /**
- * @brief  Write to the four most significant bits of the LCD's data port
- * @param  byte Byte containing the four most significant bits to be written
- * @retval None
+ * @brief  Free slots of the output queue
+ * @retval Number of bytes lcd_push() would accept
  */
-static void lcd_4b_wrt(uint8_t byte)
+static uint8_t lcd_room(void)
 {
-    LCD_E_SBIT = 1;
-    PORT_LCD_D &= ~HIGH_NIB_MASK;
-    PORT_LCD_D |= byte & HIGH_NIB_MASK;
-    LCD_E_SBIT = 0;
+    return LCD_Q_LEN - (uint8_t)(lcd_qhead - lcd_qtail);
+}
+
+/**
+ * @brief  Queue a byte for lcd_isr()
+ * @param  byte Byte to be written
+ * @param  kind LCD_Q_DATA, LCD_Q_CMD or LCD_Q_SLOW_CMD
+ * @note   Starts TMR1 if it was stopped, which only happens once the
+ *         execution time of the last byte sent has elapsed
+ * @retval True if queued, false if the queue was full
+ */
+static bool lcd_push(uint8_t byte, uint8_t kind)
+{
+    if (!lcd_room())
+        return false;
+    lcd_qbyte[lcd_qhead & LCD_Q_MASK] = byte;
+    lcd_qkind[lcd_qhead & LCD_Q_MASK] = kind;
+    lcd_qhead++;
+    if (!TR1) {
+        TR1 = 1;
+        TF1 = 1;
+    }
+    return true;
 }
 
 /**
  * @brief  Send byte as a command to the LCD
  * @param  cmd Command to be executed
+ * @note   Set DDRAM address and LCD_CLEAR only act on the framebuffer (see lcd_flush).
+ *         Others are queued (waiting only if the queue is full)
  * @retval None
  */
 void lcd_cmd(uint8_t cmd)
 {
-    LCD_RS_SBIT = 0;
-    lcd_4b_wrt(cmd);
-    lcd_4b_wrt(swap_nibs(cmd));
-    delay_ms(LCD_MAX_BUSY_DELAY_MS);
+    if (cmd & LCD_DDRAM_CMD) {
+        lcd_line = (cmd & LCD_LINE2_ADDR) != 0;
+        lcd_col = cmd & ~(LCD_DDRAM_CMD | LCD_LINE2_ADDR);
+        return;
+    }
+    if (cmd == LCD_CLEAR) {
+        for (lcd_line = 0; lcd_line < LCD_LINES; lcd_line++)
+            for (lcd_col = 0; lcd_col < LCD_LINE_LEN; lcd_col++)
+                lcd_fb[lcd_line][lcd_col] = ' ';
+        lcd_line = lcd_col = 0;
+        lcd_dirty = (1U << LCD_LINES) - 1;
+        return;
+    }
+    if ((cmd & LCD_DCB_MASK) == LCD_DCBOFF)
+        lcd_cursor = (cmd & LCD_CB_MASK) != 0;
+    else
+        lcd_ac = LCD_AC_UNKNOWN; // Home, shifts...
+    while (!lcd_push(cmd, cmd < LCD_CDEC ? LCD_Q_SLOW_CMD : LCD_Q_CMD));
 }
 
 /**
- * @brief  Send byte as a character to the LCD
+ * @brief  Write a character into the framebuffer at the writers' cursor
  * @param  c Character to be printed on the LCD
+ * @note   Cursor advances as the LCD's does (LCD_ROWONE continues on LCD_ROWTHREE).
+ *         Shown on the next lcd_flush()
  * @retval None
  */
 void lcd_putchar(char c)
 {
-    LCD_RS_SBIT = 1;
-    lcd_4b_wrt(c);
-    lcd_4b_wrt(swap_nibs(c));
-    delay_ms(LCD_REWRITE_DELAY_MS);
+    if (lcd_col < LCD_LINE_LEN && lcd_fb[lcd_line][lcd_col] != c) {
+        lcd_fb[lcd_line][lcd_col] = c;
+        lcd_dirty |= 1U << lcd_line;
+    }
+    lcd_col++;
+}
+
+/**
+ * @brief  Queue the framebuffer cells that differ from the display
+ * @note   The address is only set when the LCD's own increment does not already
+ *         point to the next changed cell, so the cost follows the changes.
+ *         Never waits: whatever does not fit in the queue is left for the next call
+ * @retval None
+ */
+void lcd_flush(void)
+{
+    uint8_t l, i, addr;
+    for (l = 0; l < LCD_LINES; l++) {
+        if (!(lcd_dirty & 1U << l))
+            continue;
+        for (i = 0; i < LCD_LINE_LEN; i++) {
+            if (lcd_fb[l][i] == lcd_shown[l][i])
+                continue;
+            if (lcd_room() < 2)
+                return;
+            addr = l ? LCD_LINE2_ADDR + i : i;
+            if (lcd_ac != addr)
+                lcd_push(LCD_DDRAM_CMD | addr, LCD_Q_CMD);
+            lcd_push(lcd_shown[l][i] = lcd_fb[l][i], LCD_Q_DATA);
+            lcd_ac = addr + 1;
+        }
+        lcd_dirty &= ~(1U << l);
+    }
+    addr = lcd_line ? LCD_LINE2_ADDR + lcd_col : lcd_col;
+    if (lcd_cursor && lcd_ac != addr && lcd_push(LCD_DDRAM_CMD | addr, LCD_Q_CMD))
+        lcd_ac = addr;
+}
+
+/**
+ * @brief  Send the next queued byte to the LCD
+ * @note   TMR1 Interrupt Subroutine (TF1 cleared by hardware). TMR1 then times the
+ *         execution of the byte, and is stopped on the first overflow with an empty queue.
+ *         With LCD_RW_SBIT, the busy flag is polled every LCD_POLL_MC instead
+ * @retval None
+ */
+void lcd_isr(void) __interrupt(TF1_VECTOR)
+{
+    uint8_t i;
+    if (lcd_qhead == lcd_qtail) {
+        TR1 = 0;
+        return;
+    }
+#ifdef LCD_RW_SBIT
+    if (lcd_busy()) {
+        TMR1_LOAD(LCD_POLL_MC);
+        return;
+    }
+#endif
+    i = lcd_qtail & LCD_Q_MASK;
+    LCD_RS_SBIT = lcd_qkind[i] == LCD_Q_DATA;
+    lcd_4b_wrt(lcd_qbyte[i]);
+    lcd_4b_wrt(swap_nibs(lcd_qbyte[i]));
+#ifdef LCD_RW_SBIT
+    TMR1_LOAD(LCD_POLL_MC);
+#else
+    if (lcd_qkind[i] == LCD_Q_SLOW_CMD)
+        TMR1_LOAD(LCD_SLOW_EXEC_MC);
+    else
+        TMR1_LOAD(LCD_FAST_EXEC_MC);
+#endif
+    lcd_qtail++;
 }
 
 /**
@@ -109,11 +293,6 @@ void lcd_puts(const char *str)
         lcd_putchar(*str++);
 }
 
-#if !defined(ENABLE_PUTU) && (defined(ENABLE_PUTI) || defined(ENABLE_PUTF))
-#define ENABLE_PUTU
-static
-#endif
-
 #ifdef ENABLE_PUTU
 /**
  * @brief  Send an unsigned integer as an array of characters to the LCD
@@ -123,14 +302,9 @@ static
  */
 void lcd_putu(uint16_t val)
 {
-    uint8_t i = 0;
-    char s[(int)(LOG10_256 * sizeof(val)) + 1]; // max_digits
-    do {
-        s[i++] = (char)(val % 10) + '0';
-    } while (val /= 10);
-    do {
-        lcd_putchar(s[--i]);
-    } while (i);
+    char s[FMT_U16_LEN];
+    fmt_u16(s, val);
+    lcd_puts(s);
 }
 #endif
 
@@ -143,34 +317,23 @@ void lcd_putu(uint16_t val)
  */
 void lcd_puti(int16_t val)
 {
-    if (val < 0) {
-        lcd_putchar('-');
-        lcd_putu(-val); // INT_MIN handled properly
-    } else {
-        lcd_putu(val);
-    }
+    char s[FMT_I16_LEN];
+    fmt_i16(s, val);
+    lcd_puts(s);
 }
 #endif
 
-#ifdef ENABLE_PUTF
+#ifdef ENABLE_PUTQ8
 /**
- * @brief  Send a float as an array of characters to the LCD
- * @param  val Float to be sent to the LCD
- * @note   Value must be within ± lcd_putu's range plus 2 decimal places.
- *         Assumed that the LCD has enough columns for all characters
+ * @brief  Send a Q8 fixed-point value with 2 decimal places to the LCD
+ * @param  val Q8 value to be sent to the LCD
+ * @note   Assumed that the LCD has enough columns for all characters
  * @retval None
  */
-void lcd_putf(float val)
+void lcd_putq8(int16_t val)
 {
-    uint16_t temp;
-    if (val < 0.0f) {
-        lcd_putchar('-');
-        val = -val;
-    }
-    lcd_putu(temp = val);
-    lcd_putchar('.');
-    temp = 100.0f * (val - temp) + 0.5f;
-    lcd_putchar(((char)temp / 10) % 10 + '0');
-    lcd_putchar((char)temp % 10 + '0');
+    char s[FMT_Q8_LEN];
+    fmt_q8(s, val);
+    lcd_puts(s);
 }
-#endif
\ No newline at end of file
+#endif
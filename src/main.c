@@ -10,20 +10,33 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "utils.h"
+#include "timer.h"
 #include "lcd.h"
 #include "joystick.h"
 #include "accel.h"
 #include "servo.h"
+#include "shape.h"
+#include "calib.h"
+#include "auto_path.h"
 
 /* Private macros -------------------------------------------------------------*/
-#define DBNC_BTN(BTN_CHK) do {delay_ms(DBNC_DELAY_MS); while (BTN_CHK);} while (0)
-#define ISUB(N, A, B) ((uint##N##_t)((A) - (B))) // Ensure correct casting. A ≥ B required
-#define NORM_INT(N, A, MIN, MAX) (2.0 * MAX_DELTA / ISUB(N, MAX, MIN) * ISUB(N, A, MIN) - MAX_DELTA)
-#define INT_THRSH(T, MIN, MAX) ROUND(ISUB(64, MAX, MIN) * ((T) + 1) / 2 + (MIN))
-#define OVER_THRSH(A, MIN, MAX, T) ((A) <= INT_THRSH(-T, MIN, MAX) || (A) >= INT_THRSH(T, MIN, MAX))
-
-/* Public functions' prototypes -----------------------------------------------*/
-void delay_ms(uint16_t ms_cnt);
+#if SV_HW_PWM
+#undef BTN1_CHK
+#define BTN1_CHK BTN1_is_PWM1_with_SV_HW_PWM // P1.1 is an output, any use fails to compile
+#endif
+#if SV_HW_PWM && defined(XLDA_INT1_WIRED)
+#error "SV_HW_PWM moves BTNA_CHK to BTN5, taken by XLDA_INT1_WIRED: give BUT.A another button"
+#endif
+#ifdef XLDA_INT1_WIRED
+#undef BTN5_CHK
+#define BTN5_CHK BTN5_is_INT1_with_XLDA_INT1_WIRED // P3.3 is the LSM6DS33's INT1
+#endif
+#define DBNC_LOCK() do {dbnc_end = tmr_now() + TMR_MS(DBNC_DELAY_MS); dbnc_lock = true;} while (0)
+#define BTN(BTN_CHK) (!dbnc_lock && (BTN_CHK)) // Press not part of an already handled one
+#define BTN_ANY_CHK (BTNA_CHK || BTNB_CHK || BTNC_CHK || JSTK_TIP_BTN_CHK)
+#define VEL_K ((int32_t)ROUND(MAX_SPEED * 65536 / TMR_TICK_FREQ * Q8_ONE / SHAPE_ONE)) // Q8 cm << 16 per tick
+#define CAL_LUT(T, E) SHAPE_LUT16(0, 0, 65535.0, T, E) // Over cal_norm()'s output
+#define OFS_BIN 0x8000U // int16_t to offset binary
 
 /* Private functions' prototypes ----------------------------------------------*/
 static void state_init(void);
@@ -31,11 +44,23 @@ static void state_idle(void);
 static void state_jstk(void);
 static void state_xlda(void);
 static void state_auto(void);
+static void state_cal(void);
 static void show_coords(uint8_t cursor_pos);
+static tmr_t elapsed(void);
+static int16_t integrate(int16_t n, tmr_t dt, uint16_t *frac);
+#if JSTK_HIRES
+static uint16_t denoise(cal_axis_t axis, jstk_raw_t raw, uint16_t noise);
+#endif
 
 /* Private variables ----------------------------------------------------------*/
 static void (*current_state)(void) = state_init;
 static point_t current_pos = INITIAL_POSITION;
+static tmr_t dbnc_end;
+static bool dbnc_lock; // Buttons ignored until DBNC_DELAY_MS elapsed and all released
+static tmr_t last_step; // tmr_now() of the last velocity integration
+static uint16_t frac_x, frac_y; // Sub-Q8 remainders of the integrated displacements
+static const xlda_ctrl_t xl_on = XLDA_ON_VALS;
+static const xlda_ctrl_t xl_off = XLDA_OFF_VALS;
 
 /**
  * @brief  The application entry point
@@ -44,8 +69,24 @@ static point_t current_pos = INITIAL_POSITION;
 void main(void)
 {
     PLLCON = PLLCON_INIT_VAL; // Configure core clock
-    while (1)
+    while (1) {
+        if (dbnc_lock && tmr_expired(dbnc_end) && !BTN_ANY_CHK)
+            dbnc_lock = false;
         current_state();
+        lcd_flush();
+        i2c_poll(); // Background sensor reads
+    }
+}
+
+/**
+ * @brief Hook run by the SDCC startup code before the variables' initialization
+ * @note Maps the on-chip XRAM (2 kB) to the __xdata space
+ * @retval 0 to let the variables be initialized
+ */
+unsigned char __sdcc_external_startup(void)
+{
+    CFG834 |= XRAMEN;
+    return 0;
 }
 
 /**
@@ -54,7 +95,9 @@ void main(void)
  */
 static void state_init(void)
 {
+    tmr_init();
     lcd_init();
+    cal_load();
     sv_init();
     state_idle();
 }
@@ -67,6 +110,8 @@ static void state_idle(void)
 {
     if (current_state != state_idle) {
         current_state = state_idle;
+        sv_stream(false);
+        while (sv_full()); // Room in the queue, so a false sv_move() is an unreachable point
         sv_move(&current_pos); // Init/revert current_pos
         lcd_setcolor(LCD_GREEN);
         lcd_puts_at("IDLE Mode", LCD_CLEAR);
@@ -76,19 +121,25 @@ static void state_idle(void)
         return;
     }
 
-    if (BTNA_CHK) {
+    if (BTN(BTNA_CHK)) {
         state_jstk();
         return;
     }
 
-    if (BTNB_CHK) {
+    if (BTN(BTNB_CHK)) {
         state_xlda();
         return;
     }
 
-    if (BTNC_CHK) {
+    if (BTN(BTNC_CHK)) {
         state_auto();
-        DBNC_BTN(BTNC_CHK);
+        DBNC_LOCK();
+        return;
+    }
+
+    if (BTN(JSTK_TIP_BTN_CHK)) {
+        state_cal();
+        DBNC_LOCK();
         return;
     }
 }
@@ -101,19 +152,23 @@ static void state_jstk(void)
 {
     jstk_out_t readout;
     __idata point_t old_pos;
+    tmr_t dt;
+    static const int16_t __code lut[] = CAL_LUT(JSTK_THRSH, JSTK_EXPO);
     if (current_state != state_jstk) {
         current_state = state_jstk;
         lcd_setcolor(LCD_CYAN);
         lcd_puts_at("JSTK Mode", LCD_CLEAR);
         lcd_puts_at("BUT.C:Exit", LCD_ROWFOUR);
         jstk_init();
+        sv_stream(true); // One short-horizon target, replaced at each step
+        elapsed();
         return;
     }
 
-    if (BTNC_CHK) {
+    if (BTN(BTNC_CHK)) {
         jstk_disable();
         state_idle();
-        DBNC_BTN(BTNC_CHK);
+        DBNC_LOCK();
         return;
     }
 
@@ -123,16 +178,19 @@ static void state_jstk(void)
         return;
     }
 
+    dt = elapsed();
     old_pos = current_pos;
 
-    if (OVER_THRSH(readout.x, JSTK_X_MIN, JSTK_X_MAX, JSTK_THRSH))
-        current_pos.x += NORM_INT(8, readout.x, JSTK_X_MIN, JSTK_X_MAX);
-
-    if (OVER_THRSH(readout.y, JSTK_Y_MIN, JSTK_Y_MAX, JSTK_THRSH))
-        current_pos.y += NORM_INT(8, readout.y, JSTK_Y_MIN, JSTK_Y_MAX);
+#if JSTK_HIRES
+    current_pos.x += integrate(shape_u16(lut, denoise(CAL_JX, readout.x, readout.noise)), dt, &frac_x);
+    current_pos.y += integrate(shape_u16(lut, denoise(CAL_JY, readout.y, readout.noise)), dt, &frac_y);
+#else
+    current_pos.x += integrate(shape_u16(lut, cal_norm(CAL_JX, readout.x)), dt, &frac_x);
+    current_pos.y += integrate(shape_u16(lut, cal_norm(CAL_JY, readout.y)), dt, &frac_y);
+#endif
 
-    if (JSTK_TIP_BTN_CHK) {
-        DBNC_BTN(JSTK_TIP_BTN_CHK);
+    if (BTN(JSTK_TIP_BTN_CHK)) {
+        DBNC_LOCK();
         current_pos.z = !current_pos.z;
     }
 
@@ -150,38 +208,51 @@ static void state_xlda(void)
 {
     xlda_out_t readout;
     __idata point_t old_pos;
-    static i2c_status_t init_nack;
-    static const xlda_ctrl_t xl_on = XLDA_ON_VALS;
-    static const xlda_ctrl_t xl_off = XLDA_OFF_VALS;
+    tmr_t dt;
+    static const int16_t __code lut[] = CAL_LUT(XLDA_THRSH, XLDA_EXPO);
+    static i2c_status_t xl_err;
+    static bool xl_shown; // An error is on the LCD
     if (current_state != state_xlda) {
         current_state = state_xlda;
         lcd_setcolor(LCD_CYAN);
         lcd_puts_at("XLDA Mode", LCD_CLEAR);
         lcd_puts_at("BUT.C:Exit", LCD_ROWFOUR);
-        init_nack = xlda_init(&xl_on);
+        xl_err = xlda_init(&xl_on);
+        xl_shown = false;
+        sv_stream(true); // One short-horizon target, replaced at each step
+        elapsed();
         return;
     }
 
-    if (BTNC_CHK) {
+    if (BTN(BTNC_CHK)) {
         xlda_init(&xl_off);
         state_idle();
-        DBNC_BTN(BTNC_CHK);
+        DBNC_LOCK();
         return;
     }
 
-    if (init_nack || xlda_read(&readout)) {
+    if (!xl_err)
+        xl_err = xlda_read(&readout); // Bounded by XLDA_TIMEOUT_MS, BUT.C stays live
+    if (xl_err) {
         lcd_setcolor(LCD_RED);
-        lcd_puts_at("I2C_ERR", LCD_ROWTWO);
+        lcd_puts_at(xl_err == I2C_TIMEOUT ? "I2C_TIMEOUT" : "I2C_ERR    ", LCD_ROWTWO);
+        xl_shown = true;
+        xl_err = xlda_init(&xl_on); // Retried until the sensor answers again, the arm holds
+        elapsed();
         return;
     }
 
-    old_pos = current_pos;
+    if (xl_shown) {
+        lcd_setcolor(LCD_CYAN);
+        lcd_puts_at("           ", LCD_ROWTWO);
+        xl_shown = false;
+    }
 
-    if (OVER_THRSH(readout.x, XLDA_X_MIN, XLDA_X_MAX, XLDA_THRSH))
-        current_pos.x += NORM_INT(16, readout.x, XLDA_X_MIN, XLDA_X_MAX);
+    dt = elapsed();
+    old_pos = current_pos;
 
-    if (OVER_THRSH(readout.y, XLDA_Y_MIN, XLDA_Y_MAX, XLDA_THRSH))
-        current_pos.y += NORM_INT(16, readout.y, XLDA_Y_MIN, XLDA_Y_MAX);
+    current_pos.x += integrate(shape_u16(lut, cal_norm(CAL_LX, readout.x ^ OFS_BIN)), dt, &frac_x);
+    current_pos.y += integrate(shape_u16(lut, cal_norm(CAL_LY, readout.y ^ OFS_BIN)), dt, &frac_y);
 
     current_pos.z = readout.z >= 0; // Tip down with non-negative g
 
@@ -198,7 +269,7 @@ static void state_xlda(void)
 static void state_auto(void)
 {
     static uint16_t p_cnt;
-    static const point_t auto_arr[] = AUTO_MODE_POINTS;
+    static const sv_arm_t __code auto_arr[] = AUTO_MODE_CNTS;
     if (current_state != state_auto) {
         current_state = state_auto;
         lcd_setcolor(LCD_MAGENTA);
@@ -208,26 +279,94 @@ static void state_auto(void)
         return;
     }
 
-    if (BTNC_CHK || p_cnt == ARR_SIZE(auto_arr)) {
+    if (BTN(BTNC_CHK) || (p_cnt == ARR_SIZE(auto_arr) && !sv_busy())) {
         p_cnt = 0;
         lcd_cmd(LCD_DONCBOFF);
         state_idle();
-        DBNC_BTN(BTNC_CHK);
+        DBNC_LOCK();
         return;
     }
 
-    if (sv_move(&auto_arr[p_cnt++])) {
-        lcd_cmd(LCD_ROWTHREE);
-        lcd_putu(p_cnt);
-        lcd_putchar('/');
-        lcd_putu(ARR_SIZE(auto_arr));
-    } else {
-        /* Skipped points not counted */
-        lcd_setcolor(LCD_RED);
-        lcd_puts_at("BAD_COORD.", LCD_ROWTWO);
+    if (p_cnt == ARR_SIZE(auto_arr) || sv_full()) // Keep the motion queue topped up
+        return;
+
+    sv_setarm(auto_arr[p_cnt++]); // Range checked at build time
+    lcd_cmd(LCD_ROWTHREE);
+    lcd_putu(p_cnt);
+    lcd_putchar('/');
+    lcd_putu(ARR_SIZE(auto_arr));
+}
+
+/**
+ * @brief Calibrate the joystick range and the accelerometer level, stored in Flash/EE
+ * @note The joystick is to be swept to its limits with the board held level
+ * @retval None
+ */
+static void state_cal(void)
+{
+    jstk_out_t js;
+    xlda_out_t xl;
+    cal_status_t status;
+    static cal_rec_t rec;
+    static int32_t lx_sum, ly_sum;
+    static uint16_t lvl_cnt;
+    static i2c_status_t init_nack;
+    if (current_state != state_cal) {
+        current_state = state_cal;
+        lcd_setcolor(LCD_YELLOW);
+        lcd_puts_at("CAL Mode", LCD_CLEAR);
+        lcd_puts_at("Sweep+level", LCD_ROWTWO);
+        lcd_puts_at("BUT.A:Quit", LCD_ROWTHREE);
+        lcd_puts_at("BUT.C:Save", LCD_ROWFOUR);
+        jstk_init();
+        jstk_read(&js);
+        rec.jx_min = rec.jx_max = js.x;
+        rec.jy_min = rec.jy_max = js.y;
+        lx_sum = ly_sum = 0;
+        lvl_cnt = 0;
+        init_nack = xlda_init(&xl_on);
+        return;
+    }
+
+    if (BTN(BTNC_CHK)) {
+        status = CAL_RANGE_ERR;
+        if (lvl_cnt == 1U << CAL_LVL_SHIFT) {
+            rec.lx = lx_sum >> CAL_LVL_SHIFT;
+            rec.ly = ly_sum >> CAL_LVL_SHIFT;
+            status = cal_save(&rec);
+        }
+        if (status != CAL_OK) {
+            lcd_setcolor(LCD_RED);
+            lcd_puts_at(status == CAL_EE_ERR ? "EE_ERR     " : "CAL_ERR    ", LCD_ROWTWO);
+            DBNC_LOCK();
+            return;
+        }
+    }
+
+    if (BTN(BTNA_CHK) || BTN(BTNC_CHK)) {
+        jstk_disable();
+        xlda_init(&xl_off);
+        state_idle();
+        DBNC_LOCK();
+        return;
+    }
+
+    if (jstk_read(&js) == ADC_OK) {
+        if (js.x < rec.jx_min)
+            rec.jx_min = js.x;
+        if (js.x > rec.jx_max)
+            rec.jx_max = js.x;
+        if (js.y < rec.jy_min)
+            rec.jy_min = js.y;
+        if (js.y > rec.jy_max)
+            rec.jy_max = js.y;
     }
 
-    delay_ms(AUTO_MODE_DELAY_MS);
+    if (!init_nack && lvl_cnt < 1U << CAL_LVL_SHIFT && !xlda_read(&xl)) {
+        lx_sum += xl.x;
+        ly_sum += xl.y;
+        lvl_cnt++;
+    }
 }
 
 /**
@@ -238,19 +377,53 @@ static void state_auto(void)
 static void show_coords(uint8_t cursor_pos)
 {
     lcd_cmd(cursor_pos);
-    lcd_putf(current_pos.x);
+    lcd_putq8(current_pos.x);
     lcd_putchar(' ');
-    lcd_putf(current_pos.y);
+    lcd_putq8(current_pos.y);
     lcd_putchar(' ');
 }
 
 /**
- * @brief Blocking delay of a given number of milliseconds
- * @param ms_cnt Time of the delay in milliseconds
- * @retval None
+ * @brief Ticks since the previous call, capped to MAX_STEP_MS
+ * @retval Elapsed time in tmr_t ticks
+ */
+static tmr_t elapsed(void)
+{
+    tmr_t now = tmr_now(), dt = now - last_step;
+    last_step = now;
+    return dt > TMR_MS(MAX_STEP_MS) ? TMR_MS(MAX_STEP_MS) : dt;
+}
+
+/**
+ * @brief Integrate a velocity command over an elapsed time
+ * @param n Shaped input (±SHAPE_ONE for ±MAX_SPEED)
+ * @param dt Elapsed time in tmr_t ticks
+ * @param frac Remainder below the Q8 resolution, carried to the next call
+ * @retval Displacement in Q8 centimeters
  */
-void delay_ms(uint16_t ms_cnt)
+static int16_t integrate(int16_t n, tmr_t dt, uint16_t *frac)
 {
-    for (; ms_cnt; ms_cnt--)
-        DELAY_US(1000);
-}
\ No newline at end of file
+    int32_t d = (int32_t)n * dt * VEL_K + *frac;
+    *frac = (uint16_t)d;
+    return d >> 16;
+}
+
+#if JSTK_HIRES
+/**
+ * @brief Normalize a joystick axis, held at the center while within its noise
+ * @param axis CAL_JX or CAL_JY
+ * @param raw Reading
+ * @param noise jstk_out_t.noise of the reading
+ * @note Floor of the JSTK_THRSH deadband, so that a small JSTK_THRSH does not let
+ *       a noisy reading drift the arm. The noise is scaled by cal_norm() itself
+ * @retval cal_norm() of the reading, 32768 if less than the noise away from it
+ */
+static uint16_t denoise(cal_axis_t axis, jstk_raw_t raw, uint16_t noise)
+{
+    uint16_t n = cal_norm(axis, raw);
+    uint16_t d = cal_norm(axis, raw > UINT16_MAX - noise ? UINT16_MAX : raw + noise) - n; // Noise, normalized
+    if ((n >= 0x8000U ? n - 0x8000U : 0x8000U - n) <= d)
+        return 0x8000U;
+    return n;
+}
+#endif
\ No newline at end of file
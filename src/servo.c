@@ -10,48 +10,258 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "servo.h"
+#include "cordic.h"
+#if SV_IK_MODE == SV_IK_GRID
+#include "ik_grid.h" // Generated by tools/ik_grid.c
+#endif
 
 /* Private macros ------------------------------------------------------------*/
 #define SQR(A) ((A) * (A))
-#define GET_SV_MASK(A) (1U << (A == BASE ? SV1_PIN : A == MID ? SV2_PIN : SV3_PIN))
-#define BRANCH_DELAY() do {NOP(); NOP();} while (0) // JNB delay
+#define MUL_U8(A, B) (((uint16_t)(HIGHBYTE(A) * (B)) << 8) + (uint16_t)(LOWBYTE(A) * (B))) // A * B, MUL AB only
+#define MUL_Q8(A, B) ((uint16_t)(HIGHBYTE(A) * (B)) + ((uint16_t)(LOWBYTE(A) * (B)) >> 8)) // A * B >> 8, MUL AB only
+
+#define SV_ACC_Q4 ((uint16_t)ROUND(SV_MAX_ACC * CORE_CLK_FREQ / 12 * 16 / SQR(SV_FREQUENCY))) // Counts/frame² (Q4)
+#define SV_VEL_Q4 ((uint16_t)(SV_MAX_VEL * CORE_CLK_FREQ / 12 * 16 / SV_FREQUENCY / SV_ACC_Q4) * SV_ACC_Q4) // Counts/frame (Q4)
+
+#if SV_NUM < 3 || SV_NUM > 4 // BASE, MID, TIP [, AUX]
+#error "SV_NUM out of range (one channel per SVx_PIN of lab_board.h)"
+#endif
+
+#if SV_QUEUE_LEN & (SV_QUEUE_LEN - 1) || SV_QUEUE_LEN > 128
+#error "SV_QUEUE_LEN must be a power of 2 up to 128"
+#endif
+#define SV_Q_MASK (SV_QUEUE_LEN - 1)
+#define SV_MC_NS  (954L << (PLLCON_INIT_VAL & PLLCON_CD_MASK)) // Machine cycle (ns), signed integer for #if
+#define SV_ISR_MC 45 // Worst case machine cycles from a TMR2 overflow to the RCAP2L write (see sv_isr)
+
+#if SV_MERGE_US * 1000L < (SV_ISR_MC + SV_ISR_MC / 4) * SV_MC_NS
+#error "SV_MERGE_US (shortest edge interval) must exceed the TMR2 reload latency (SV_ISR_MC) by 25%"
+#endif
+
+#if SV_HW_PWM
+#define SV_TMR_FIRST   TIP // First channel driven from TMR2
+#define SV_PWM_RATIO   ((uint8_t)ROUND(12 * SV_PWM_CLK_FREQ / CORE_CLK_FREQ)) // PWM clocks per machine cycle
+#define PWM_WRT(N, CNT) do {PWM##N##L = LOWBYTE(-(CNT)); PWM##N##H = HIGHBYTE(-(CNT));} while (0) // Low time of CNT
+#else
+#define SV_TMR_FIRST   BASE
+#endif
+
+#if SV_IK_MODE == SV_IK_FIXED
+#define SV_LSQ_Q16   ((int32_t)ROUND((SQR(SV_L1) + SQR(SV_L2)) * Q8_ONE * Q8_ONE))
+#define SV_2L1L2_Q16 ((int32_t)ROUND(2 * SV_L1 * SV_L2 * Q8_ONE * Q8_ONE)) // 2*L1*L2 < 256 cm² required
+#define SV_2L1SQ_Q8  ((int32_t)ROUND(2 * SQR(SV_L1) * Q8_ONE))
+#define SV_SPAN_Q5   ((uint32_t)ROUND((SV_MAX_EXCT - SV_MIN_EXCT) * 32)) // Machine cycles per PI
+#define SV_MIN_Q20   ((uint32_t)ROUND(SV_MIN_EXCT * 1048576.0))
+#define SV_BTOC(A)   ((uint16_t)(((uint32_t)(A) * SV_SPAN_Q5 + SV_MIN_Q20 + (1UL << 19)) >> 20)) // SV_RTOC of a binary angle
+#elif SV_IK_MODE == SV_IK_GRID
+#define SV_GRID_FRAC (8 - SV_IK_GRID_SHIFT) // In-cell offsets (Q8 cm) to 1/256ths of a cell
+#define SV_GRID_XMAX (SV_GRID_X0 + ((SV_GRID_NX - 1) << SV_IK_GRID_SHIFT)) // Right edge (Q8 cm)
+#define SV_GRID_YMAX ((SV_GRID_NY - 1) << SV_IK_GRID_SHIFT)                // Top edge (Q8 cm)
+#define MUL_Q8R(A, B) ((uint16_t)(HIGHBYTE(A) * (B)) + (((uint16_t)(LOWBYTE(A) * (B)) + 128) >> 8)) // MUL_Q8 rounded
+#endif
 
 /* Private variables ----------------------------------------------------------*/
-static uint16_t sv_rcap[] = { // Timer values of servos (2s comp. of machine cycles)
-    [BASE] = -SV_MID_CNT,
-    [MID] = -SV_MID_CNT,
-    [TIP] = -SV_MIN_CNT
+static const uint8_t __code sv_mask[] = { // All lines must belong to PORT_SV
+    [BASE] = 1U << SV1_PIN,
+    [MID] = 1U << SV2_PIN,
+    [TIP] = 1U << SV3_PIN,
+    [AUX] = 1U << SV4_PIN
 };
 
+static __idata uint16_t sv_stg[SV_NUM];       // Staged pulse widths in machine cycles
+static __idata uint16_t sv_q[SV_QUEUE_LEN][SV_NUM]; // Committed vectors (SPSC ring, main loop to ISR)
+static volatile uint8_t sv_qhead, sv_qtail;   // Free running, only written by sv_commit() / the ISR
+static uint8_t sv_ovr, sv_und;                // Commits refused on a full ring, segments ended on an empty one
+static bool sv_live;                          // Streamed targets, see sv_stream()
+static volatile bool sv_qwr;                  // sv_commit() running, queued vectors left alone by the ISR
+
+static uint16_t sv_cnt[SV_NUM];               // Pulse widths of the frame in progress in machine cycles
+static volatile bool sv_moving;               // A segment is running
+static bool sv_hold;                          // Lead's velocity kept for the next frame (segment change)
+static bool sv_rtg;                           // Retargeted in the last frame, the profile's turn to run
+static __idata uint16_t sv_org[SV_NUM], sv_tgt[SV_NUM]; // Segment start and end widths
+static __idata uint16_t sv_rat[SV_NUM];       // Travel relative to the lead channel (Q8)
+static uint16_t sv_len, sv_pos, sv_vel, sv_brk; // Lead's travel, position, velocity and braking distance (Q4)
+static uint8_t sv_dir;                        // Channels moving to narrower pulses (1 << servo_t)
+static volatile bool sv_plan;                 // Oldest queued vector planned as the next segment
+static __idata uint16_t sv_nrat[SV_NUM];      // Next segment's sv_rat
+static uint16_t sv_nlen, sv_vj, sv_bj;        // Next segment's sv_len, junction velocity and its sv_brk (Q4)
+static uint8_t sv_ndir;                       // Next segment's sv_dir
+static __idata uint16_t sv_rld[SV_NUM + 1];   // TMR2 reload written at each edge (last one unused)
+static __idata uint8_t sv_lvl[SV_NUM + 1];    // SV lines' state after each edge
+static volatile uint8_t sv_edge;              // Next edge (0 from the frame end edge to the frame start)
+static uint8_t sv_last, sv_keep;              // Frame end edge, non-SV bits of PORT_SV
+#if SV_IK_MODE == SV_IK_GRID
+static const uint16_t __code sv_gbase[] = SV_GRID_BASE; // BASE counts of the nodes, row by row
+static const uint16_t __code sv_gmid[] = SV_GRID_MID;   // MID counts of the nodes, row by row
+static const uint8_t __code sv_greach[] = SV_GRID_REACH; // Usable cells, one bit each (LSB first)
+#endif
+
+/* Private functions' prototypes ---------------------------------------------*/
+static uint16_t sv_path(const uint16_t *org) __using(1);
+static uint16_t sv_turn(void) __using(1);
+static void sv_junction(void) __using(1);
+static bool sv_retarget(void) __using(1);
+static void sv_seg(void) __using(1);
+static void sv_step(void) __using(1);
+static void sv_sched(void) __using(1);
+#if SV_IK_MODE == SV_IK_GRID
+static uint16_t sv_lerp(const uint16_t __code *node, uint8_t fx, uint8_t fy);
+static uint16_t sv_lerp8(uint16_t a, uint16_t b, uint8_t f);
+#endif
+
 /**
  * @brief Initialization of the driver's peripherals
- * @note TMR2 to be reserved for sending the control pulses
+ * @note TMR2 to be reserved for sending the control pulses (all but BASE/MID's with SV_HW_PWM)
  * @retval None
  */
 void sv_init(void)
 {
-    RCAP2H = HIGHBYTE(sv_rcap[BASE]);
-    RCAP2L = LOWBYTE(sv_rcap[BASE]);
+    servo_t sv;
+    sv_keep = 0xFF;
+    for (sv = BASE; sv < SV_NUM; sv++) {
+        sv_cnt[sv] = sv_tgt[sv] = sv == TIP ? SV_MIN_CNT : SV_MID_CNT;
+        sv_setcnt(sv, sv_cnt[sv]);
+        if (sv >= SV_TMR_FIRST)
+            sv_keep &= ~sv_mask[sv];
+    }
+    sv_commit();
+#if SV_HW_PWM
+    PWM_WRT(0, SV_MID_CNT * SV_PWM_RATIO);
+    PWM_WRT(1, SV_MID_CNT * SV_PWM_RATIO);
+    PWMCON = SV_PWMCON_VAL;
+#endif
+    sv_lvl[0] = ~sv_keep; // First TF2 releases all lines and schedules a frame
     EA = 1;
+    PT2 = 1; // Edges must not wait for other ISRs
     ET2 = 1;
     TR2 = 1;
 }
 
 /**
- * @brief Adjust the pulse width for a specific servomotor
+ * @brief Stage the pulse width for a specific servomotor
  * @param sv Target servomotor via servo_t enum
  * @param cnt Pulse width given as a number of machine cycles
- * @note No changes occur if value is not between SV_MIN_CNT and SV_MAX_CNT
+ * @note No changes occur if value is not between SV_MIN_CNT and SV_MAX_CNT.
+ *       Movement starts after the next sv_commit()
  * @retval True if executed, false otherwise
  */
 bool sv_setcnt(servo_t sv, uint16_t cnt)
 {
-    if (sv > TIP || cnt > SV_MAX_CNT || cnt < SV_MIN_CNT)
+    if (sv >= SV_NUM || cnt > SV_MAX_CNT || cnt < SV_MIN_CNT)
+        return false;
+    sv_stg[sv] = cnt;
+    return true;
+}
+
+/**
+ * @brief Queue the staged pulse widths as a whole
+ * @note The TMR2 ISR takes each vector at the first frame boundary after the previous
+ *       segment. The slot is filled before the head moves, so no interrupt masking.
+ *       With sv_stream() on, a vector not yet planned by the ISR is overwritten
+ *       instead, sv_qwr keeping the ISR off it meanwhile
+ * @retval True if queued, false if the queue was full (counted as an overrun)
+ */
+bool sv_commit(void)
+{
+    uint8_t i, slot = sv_qhead;
+    sv_qwr = true;
+    if (sv_live && (uint8_t)(sv_qhead - sv_qtail) > sv_plan) {
+        slot--;
+    } else if ((uint8_t)(sv_qhead - sv_qtail) == SV_QUEUE_LEN) {
+        sv_qwr = false;
+        sv_ovr++;
         return false;
-    sv_rcap[sv] = -cnt;
+    }
+    for (i = 0; i < SV_NUM; i++)
+        sv_q[slot & SV_Q_MASK][i] = sv_stg[i];
+    if (slot == sv_qhead)
+        sv_qhead++;
+    sv_qwr = false;
     return true;
 }
 
+/**
+ * @brief Switch the motion queue between waypoints and streamed targets
+ * @param on True for streamed targets (JSTK/XLDA), false for waypoints
+ * @note Streamed targets are short-horizon setpoints: each sv_commit() replaces the one
+ *       still waiting, and the ISR retargets the running segment to it, keeping the
+ *       velocity, instead of going through every committed vector
+ * @retval None
+ */
+void sv_stream(bool on)
+{
+    sv_live = on;
+}
+
+/**
+ * @brief Check whether the servomotors are still on their way to the committed widths
+ * @retval True if a segment is running or a commit is queued, false otherwise
+ */
+bool sv_busy(void)
+{
+    return sv_qhead != sv_qtail || sv_moving;
+}
+
+/**
+ * @brief Check whether the motion queue has no room for another sv_commit()
+ * @retval True if full, false otherwise
+ */
+bool sv_full(void)
+{
+    return (uint8_t)(sv_qhead - sv_qtail) == SV_QUEUE_LEN;
+}
+
+/**
+ * @brief Wait for the start of a frame's idle gap, every TMR2 line released
+ * @note Up to two frames. The next frame starts SV_FRAME_CNT - SV_MAX_CNT machine
+ *       cycles later at least (18 ms at 50 Hz), room for a core halt such as a
+ *       Flash/EE page write without stretching a pulse
+ * @retval None
+ */
+void sv_gap(void)
+{
+    while (!sv_edge); // Gap already under way, what is left of it unknown
+    while (sv_edge);
+}
+
+/**
+ * @brief Number of commits refused because the motion queue was full
+ * @note Wraps around at 256
+ * @retval Overrun count
+ */
+uint8_t sv_overruns(void)
+{
+    return sv_ovr;
+}
+
+/**
+ * @brief Number of segments that ended with the motion queue empty (motion stopped)
+ * @note Wraps around at 256. Includes the intended stops at the end of each motion
+ * @retval Underrun count
+ */
+uint8_t sv_underruns(void)
+{
+    return sv_und;
+}
+
+/**
+ * @brief Adjust the pulse widths of all the servomotors
+ * @param cnt Pulse widths given as numbers of machine cycles (e.g. from AUTO_MODE_CNTS)
+ * @note Stops at the first value not between SV_MIN_CNT and SV_MAX_CNT,
+ *       commits only if all were staged
+ * @retval True if all were queued, false otherwise
+ */
+bool sv_setarm(const sv_arm_t cnt)
+{
+    servo_t sv;
+    for (sv = BASE; sv <= TIP; sv++)
+        if (!sv_setcnt(sv, cnt[sv]))
+            return false;
+    return sv_commit();
+}
+
+#if SV_IK_MODE == SV_IK_FLOAT
 /**
  * @brief Position the arm tip over a point on the cartesian plane
  * @param p Pointer to point_t containing the x,y,z coordinates
@@ -61,55 +271,383 @@ bool sv_setcnt(servo_t sv, uint16_t cnt)
  */
 bool sv_move(const point_t *p)
 {
+    float x = p->x * (1.0f / Q8_ONE), y = p->y * (1.0f / Q8_ONE);
     float c, s, a; // cos, sin, alpha
-    c = (SQR(p->x) + SQR(p->y) - SQR(SV_L1) - SQR(SV_L2)) / (2 * SV_L1 * SV_L2);
+    c = (SQR(x) + SQR(y) - SQR(SV_L1) - SQR(SV_L2)) / (2 * SV_L1 * SV_L2);
     if (fabsf(c) > 1.0)
         return false;
-    a = atan2f(p->y, p->x) - atan2f(SV_L2 * (s = sqrtf(1 - SQR(c))), SV_L1 + SV_L2 * c);
+    a = atan2f(y, x) - atan2f(SV_L2 * (s = sqrtf(1 - SQR(c))), SV_L1 + SV_L2 * c);
     if (a <= -PI)
         a += 2 * PI;
     if (!sv_setcnt(BASE, SV_RTOC(a)))
         return false;
     sv_setcnt(TIP, p->z ? SV_MAX_CNT : SV_MIN_CNT);
-    return sv_setcnt(MID, SV_RTOC(atan2f(s, c)));
+    sv_setcnt(MID, SV_RTOC(atan2f(s, c)));
+    return sv_commit();
+}
+#elif SV_IK_MODE == SV_IK_FIXED
+/**
+ * @brief Position the arm tip over a point on the cartesian plane
+ * @param p Pointer to point_t containing the x,y,z coordinates
+ * @note Same equations as the SV_IK_FLOAT version, scaled by 2*L1*L2. Angles come
+ *       from the CORDIC kernel and go straight to counts.
+ *       Coordinates assumed within ±127 cm
+ * @retval True if all links were moved, false otherwise
+ */
+bool sv_move(const point_t *p)
+{
+    int16_t x = p->x, y = p->y;
+    int32_t c; // cos * 2*L1*L2 (Q16, then Q8)
+    uint16_t s, a; // sin * 2*L1*L2, alpha
+    c = (uint32_t)((int32_t)x * x) + (uint32_t)((int32_t)y * y) - SV_LSQ_Q16;
+    if (c > SV_2L1L2_Q16 || c < -SV_2L1L2_Q16)
+        return false;
+    /* sqrt(D^2 - c^2) = sqrt(D - c) * sqrt(D + c) keeps the full Q16 precision near c = ±D */
+    s = (uint32_t)isqrt((SV_2L1L2_Q16 - c) << 6) * isqrt((SV_2L1L2_Q16 + c) << 6) >> 14;
+    c >>= 8;
+    a = cordic_atan2(y, x) - cordic_atan2(s, SV_2L1SQ_Q8 + c);
+    if (a > BANG_PI)
+        return false;
+    sv_setcnt(BASE, SV_BTOC(a));
+    sv_setcnt(TIP, p->z ? SV_MAX_CNT : SV_MIN_CNT);
+    sv_setcnt(MID, SV_BTOC(cordic_atan2(s, c)));
+    return sv_commit();
+}
+#elif SV_IK_MODE == SV_IK_GRID
+/**
+ * @brief Position the arm tip over a point on the cartesian plane
+ * @param p Pointer to point_t containing the x,y,z coordinates
+ * @note Bilinear interpolation of the counts tabulated by tools/ik_grid.c, within
+ *       SV_IK_GRID_TOL counts of the SV_IK_FLOAT version. Points in cells left out
+ *       of SV_GRID_REACH (unreachable or too close to the workspace edges) are refused
+ * @retval True if all links were moved, false otherwise
+ */
+bool sv_move(const point_t *p)
+{
+    uint16_t dx, dy, i;
+    uint8_t fx, fy;
+    if (p->x < SV_GRID_X0 || p->x >= SV_GRID_XMAX || p->y < 0 || p->y >= SV_GRID_YMAX)
+        return false;
+    dx = p->x - SV_GRID_X0;
+    dy = p->y;
+    i = (dy >> SV_IK_GRID_SHIFT) * (SV_GRID_NX - 1) + (dx >> SV_IK_GRID_SHIFT); // Cell
+    if (!(sv_greach[i >> 3] & 1 << (i & 7)))
+        return false;
+    i += dy >> SV_IK_GRID_SHIFT; // Its lower left node
+    fx = (uint8_t)(dx << SV_GRID_FRAC);
+    fy = (uint8_t)(dy << SV_GRID_FRAC);
+    sv_setcnt(BASE, sv_lerp(&sv_gbase[i], fx, fy));
+    sv_setcnt(TIP, p->z ? SV_MAX_CNT : SV_MIN_CNT);
+    sv_setcnt(MID, sv_lerp(&sv_gmid[i], fx, fy));
+    return sv_commit();
+}
+
+/**
+ * @brief Bilinear interpolation of a grid cell
+ * @param node Pointer to the lower left node of the cell in sv_gbase or sv_gmid
+ * @param fx Horizontal position within the cell (1/256ths)
+ * @param fy Vertical position within the cell (1/256ths)
+ * @retval Interpolated count
+ */
+static uint16_t sv_lerp(const uint16_t __code *node, uint8_t fx, uint8_t fy)
+{
+    uint16_t lo = sv_lerp8(node[0], node[1], fx);
+    return sv_lerp8(lo, sv_lerp8(node[SV_GRID_NX], node[SV_GRID_NX + 1], fx), fy);
 }
 
 /**
- * @brief Transmit the control pulses of the servomotors at a ~SV_FREQUENCY rate
- * @note TMR2 Interrupt Subroutine (TF2 not cleared by hardware)
+ * @brief Linear interpolation between two counts
+ * @param a Count at f = 0
+ * @param b Count at f = 256
+ * @param f Position between a and b (1/256ths)
+ * @note Works on the magnitude of b - a to keep to MUL AB
+ * @retval a + (b - a) * f / 256, rounded
+ */
+static uint16_t sv_lerp8(uint16_t a, uint16_t b, uint8_t f)
+{
+    if (b >= a)
+        return a + MUL_Q8R(b - a, f);
+    return a - MUL_Q8R(a - b, f);
+}
+#endif
+
+/**
+ * @brief Travel ratios and directions of a path to the oldest queued vector
+ * @param org Pointer to the path's start widths
+ * @note Ratios to the lead (longest travel) channel through a 9-step restoring
+ *       division, rounded to Q8. 256 for the lead itself. Results in sv_nrat/sv_ndir
+ * @retval Lead's travel (Q4)
+ */
+#pragma nooverlay
+static uint16_t sv_path(const uint16_t *org) __using(1)
+{
+    uint8_t i, j, m;
+    uint16_t max = 0, r, t;
+    __idata uint16_t d[SV_NUM];
+    sv_ndir = 0;
+    for (i = 0, m = 1; i < SV_NUM; i++, m <<= 1) {
+        t = sv_q[sv_qtail & SV_Q_MASK][i];
+        if (t < org[i]) {
+            d[i] = org[i] - t;
+            sv_ndir |= m;
+        } else {
+            d[i] = t - org[i];
+        }
+        if (d[i] > max)
+            max = d[i];
+    }
+    for (i = 0; i < SV_NUM; i++) {
+        for (j = 9, r = 0; j; j--) { // d <= max, so d * 512 / max <= 511
+            d[i] <<= 1;
+            r <<= 1;
+            if (d[i] >= max) {
+                d[i] -= max;
+                r |= 1;
+            }
+        }
+        sv_nrat[i] = (r + 1) >> 1;
+    }
+    return max << 4;
+}
+
+/**
+ * @brief Turn from the running segment's ratios to the next one's
+ * @retval Largest change of a channel's ratio (Q8, up to 512 for a reversal)
+ */
+#pragma nooverlay
+static uint16_t sv_turn(void) __using(1)
+{
+    uint8_t i, m;
+    uint16_t d = 0, t;
+    for (i = 0, m = 1; i < SV_NUM; i++, m <<= 1) {
+        if ((sv_dir ^ sv_ndir) & m)
+            t = sv_rat[i] + sv_nrat[i];
+        else
+            t = sv_rat[i] > sv_nrat[i] ? sv_rat[i] - sv_nrat[i] : sv_nrat[i] - sv_rat[i];
+        if (t > d)
+            d = t;
+    }
+    return d;
+}
+
+/**
+ * @brief Lead's velocity at the junction of the running segment with the planned one
+ * @note The lead's velocity is carried through the junction, where each channel turns
+ *       from its old ratio to its new one. Largest multiple of SV_ACC_Q4 (up to
+ *       SV_VEL_Q4) for which no channel changes speed by more than SV_ACC_Q4 in the
+ *       turn, and from which the next segment can still stop after one more frame.
+ *       Zero (stop at the junction) for reversals and short next segments
  * @retval None
  */
-void sv_isr(void) __interrupt(TF2_VECTOR) __naked
-{
-    __asm CLR TF2
-    jnb PORT_SV + SV1_PIN, $base
-    jnb PORT_SV + SV2_PIN, $mid
-    jnb PORT_SV + SV3_PIN, $tip __endasm;
-
-    PORT_SV ^= GET_SV_MASK(BASE);
-    RCAP2H = HIGHBYTE(sv_rcap[MID]);
-    RCAP2L = LOWBYTE(sv_rcap[MID]);
-    __asm reti
-
-    $base : __endasm;
-    BRANCH_DELAY(); // Ensure same ON/OFF timing
-    BRANCH_DELAY();
-    PORT_SV ^= GET_SV_MASK(BASE) | GET_SV_MASK(MID);
-    RCAP2H = HIGHBYTE(sv_rcap[TIP]);
-    RCAP2L = LOWBYTE(sv_rcap[TIP]);
-    __asm reti
-
-    $mid : __endasm;
-    BRANCH_DELAY();
-    PORT_SV ^= GET_SV_MASK(MID) | GET_SV_MASK(TIP);
-    RCAP2H = HIGHBYTE(-SV_PERIOD_CNT);
-    RCAP2L = LOWBYTE(-SV_PERIOD_CNT);
-    __asm reti
-
-    $tip : __endasm;
-    /* Reset all to fix duty cycle inversion if pins were altered */
-    PORT_SV |= GET_SV_MASK(BASE) | GET_SV_MASK(MID) | GET_SV_MASK(TIP);
-    RCAP2H = HIGHBYTE(sv_rcap[BASE]);
-    RCAP2L = LOWBYTE(sv_rcap[BASE]);
-    __asm reti __endasm;
+#pragma nooverlay
+static void sv_junction(void) __using(1)
+{
+    uint16_t d = sv_turn(), t;
+    sv_vj = sv_bj = 0;
+    for (t = d; sv_vj < SV_VEL_Q4 && t <= 256 && sv_bj + sv_vj + sv_vj + sv_vj + 2 * SV_ACC_Q4 <= sv_nlen; t += d) {
+        sv_bj += sv_vj;
+        sv_vj += SV_ACC_Q4;
+    }
+}
+
+/**
+ * @brief Retarget the running segment to the streamed vector if it keeps the limits
+ * @note New segment from the current widths with the same velocity, taken only if the
+ *       turn changes no channel's speed by more than SV_ACC_Q4 and the new target is
+ *       still far enough to stop after one more frame. Otherwise the running segment
+ *       goes on, braking to its end, and the next frame tries again
+ * @retval True if retargeted
+ */
+#pragma nooverlay
+static bool sv_retarget(void) __using(1)
+{
+    uint8_t i;
+    uint16_t len = sv_path(sv_cnt), d = sv_turn(), t = 0, v;
+    for (v = 0; v < sv_vel; v += SV_ACC_Q4)
+        t += d;
+    if (t > 256 || sv_brk + sv_vel + sv_vel > len)
+        return false;
+    for (i = 0; i < SV_NUM; i++)
+        sv_tgt[i] = sv_cnt[i]; // Origin of the new segment
+    sv_nlen = len;
+    sv_seg();
+    return true;
+}
+
+/**
+ * @brief Start the planned segment from the end of the previous one
+ * @note Takes the oldest queued vector, the lead's position and velocity are left
+ *       to the caller
+ * @retval None
+ */
+#pragma nooverlay
+static void sv_seg(void) __using(1)
+{
+    uint8_t i;
+    for (i = 0; i < SV_NUM; i++) {
+        sv_org[i] = sv_tgt[i];
+        sv_tgt[i] = sv_q[sv_qtail & SV_Q_MASK][i];
+        sv_rat[i] = sv_nrat[i];
+    }
+    sv_qtail++; // Slot back to sv_commit()
+    sv_dir = sv_ndir;
+    sv_len = sv_nlen;
+    sv_pos = 0;
+    sv_plan = false;
+    sv_vj = sv_bj = 0;
+    sv_moving = true;
+}
+
+/**
+ * @brief Advance the motion profile by one frame
+ * @note Trapezoidal profile of the lead channel: accelerate while the braking distance
+ *       (kept up to date with additions) still fits, cruise at SV_VEL_Q4, brake
+ *       otherwise, so it never overshoots. The other channels follow with their ratio
+ *       so that all arrive together. No library multiplication/division involved.
+ *       A queued vector is planned as soon as it comes: the profile then only brakes
+ *       down to sv_vj and crosses into the next segment without stopping. The frame
+ *       after a crossing keeps the velocity, so the turn and the profile never change
+ *       a channel's speed in the same frame. What is left once stopped (short moves
+ *       included) is covered in one frame at less than SV_ACC_Q4, followed by a frame
+ *       at rest, so that a reversal never changes a channel's speed by more than
+ *       SV_ACC_Q4 either. Streamed vectors are never planned (they may still be
+ *       replaced) but retargeted to, that frame keeping the velocity as well
+ * @retval None
+ */
+#pragma nooverlay
+static void sv_step(void) __using(1)
+{
+    uint8_t i, m;
+    uint16_t u;
+    bool hold = sv_hold, rtg = sv_rtg;
+    sv_hold = sv_rtg = false;
+    if (!sv_plan && sv_qhead != sv_qtail && !sv_qwr) {
+        if (!sv_moving || !sv_live) {
+            sv_nlen = sv_path(sv_tgt);
+            sv_plan = true;
+            if (sv_moving)
+                sv_junction();
+        } else if (!hold && !rtg && sv_retarget()) {
+            hold = sv_rtg = true;
+        }
+    }
+    if (!sv_moving) {
+        if (!sv_plan)
+            return;
+        sv_seg();
+    }
+    u = sv_len - sv_pos;
+    if (hold) {
+        /* Velocity kept */
+    } else if (sv_vel < SV_VEL_Q4 && sv_brk + sv_vel + sv_vel + SV_ACC_Q4 <= u + sv_bj && sv_vel + SV_ACC_Q4 < u) {
+        sv_brk += sv_vel; // Never accelerates into a junction
+        sv_vel += SV_ACC_Q4;
+    } else if (sv_vel > sv_vj && sv_brk + sv_vel > u + sv_bj) {
+        sv_vel -= SV_ACC_Q4;
+        sv_brk -= sv_vel;
+    }
+    if (sv_vel >= u && sv_vel && sv_vel <= sv_vj) { // Crossing, what is left goes to the next segment
+        u = sv_vel - u;
+        sv_seg();
+        sv_pos = u;
+        sv_hold = true;
+    } else if (sv_vel >= u) {
+        sv_pos = sv_len;
+    } else if (sv_vel) {
+        sv_pos += sv_vel;
+    } else if (!hold) {
+        sv_pos = sv_len; // Less than SV_ACC_Q4 left once stopped
+    }
+    for (i = 0, m = 1; i < SV_NUM; i++, m <<= 1) {
+        if (sv_pos == sv_len) {
+            sv_cnt[i] = sv_tgt[i];
+            continue;
+        }
+        u = sv_rat[i] > 0xFF ? sv_pos : MUL_Q8(sv_pos, (uint8_t)sv_rat[i]);
+        u = (u + 8) >> 4;
+        if (sv_dir & m) // Clamped as the ratio is rounded
+            sv_cnt[i] = sv_org[i] - u > sv_tgt[i] ? sv_org[i] - u : sv_tgt[i];
+        else
+            sv_cnt[i] = sv_org[i] + u < sv_tgt[i] ? sv_org[i] + u : sv_tgt[i];
+    }
+    if (sv_pos == sv_len) {
+        sv_moving = false;
+        sv_hold = true; // A frame at rest
+        sv_vel = sv_brk = 0;
+        if (!sv_plan)
+            sv_und++;
+    }
+}
+
+/**
+ * @brief Build the edge schedule of the next frame from the current pulse widths
+ * @note Channels are insertion sorted by width, all lines go active at the frame
+ *       start and each one is released at its own edge. A width less than SV_MERGE_CNT
+ *       past the last edge placed joins it, the edge moving to the midpoint of its
+ *       group (error < SV_MERGE_CNT), so edges stay at least SV_MERGE_CNT apart.
+ *       Loads the reload value of the first interval (frame start to first edge)
+ * @retval None
+ */
+#pragma nooverlay
+static void sv_sched(void) __using(1)
+{
+    uint8_t sv, i, n = 0, e = 0;
+    uint16_t first = 0; // First width of the current group
+    __idata uint8_t ord[SV_NUM];
+    __idata uint16_t t[SV_NUM + 1]; // Edge times
+    for (sv = SV_TMR_FIRST; sv < SV_NUM; sv++) {
+        for (i = n++; i && sv_cnt[ord[i - 1]] > sv_cnt[sv]; i--)
+            ord[i] = ord[i - 1];
+        ord[i] = sv;
+    }
+    sv_lvl[0] = 0; // All lines active
+    for (i = 0; i < n; i++) {
+        sv = ord[i];
+        if (e && sv_cnt[sv] - t[e] < SV_MERGE_CNT) { // Edges only move later as groups grow
+            t[e] = (first + sv_cnt[sv]) >> 1;
+            sv_lvl[e] |= sv_mask[sv];
+        } else {
+            t[++e] = first = sv_cnt[sv];
+            sv_lvl[e] = sv_lvl[e - 1] | sv_mask[sv];
+        }
+    }
+    for (i = 1; i < e; i++)
+        sv_rld[i - 1] = t[i] - t[i + 1];
+    sv_rld[e - 1] = t[e] - SV_FRAME_CNT;
+    sv_last = e;
+    RCAP2H = HIGHBYTE(-t[1]);
+    RCAP2L = LOWBYTE(-t[1]);
+}
+
+/**
+ * @brief Transmit the control pulses of the servomotors at a fixed SV_FREQUENCY rate
+ * @note TMR2 Interrupt Subroutine (TF2 not cleared by hardware). One interrupt per edge
+ *       (at most SV_NUM + 1 per frame) through the same path up to the port write, so
+ *       all edges share the same latency. The reload written at each edge is the one
+ *       of the interval after the next (auto-reload pipelining) and must land before
+ *       the next overflow, so it is written first, even at the frame end edge (where
+ *       sv_sched() overwrites it). Worst case up to the RCAP2L write (SV_ISR_MC):
+ *       9 cycles of interrupt latency (RETI then MUL), 2 of the vector's LJMP, 16 of
+ *       prologue (7 PUSHes and the bank switch) and 18 of TF2/RCAP2 code, which
+ *       SV_MERGE_CNT must exceed (sv_sched() keeps edges that far apart). The frame
+ *       end edge advances the motion profile and schedules the next frame
+ * @retval None
+ */
+void sv_isr(void) __interrupt(TF2_VECTOR) __using(1)
+{
+    TF2 = 0;
+    RCAP2H = HIGHBYTE(sv_rld[sv_edge]);
+    RCAP2L = LOWBYTE(sv_rld[sv_edge]);
+    PORT_SV = (PORT_SV & sv_keep) | sv_lvl[sv_edge];
+    if (sv_edge != sv_last) {
+        sv_edge++;
+    } else { /* Frame end, every line is released */
+        sv_edge = 0;
+        sv_step();
+#if SV_HW_PWM
+        PWM_WRT(0, MUL_U8(sv_cnt[BASE], SV_PWM_RATIO));
+        PWM_WRT(1, MUL_U8(sv_cnt[MID], SV_PWM_RATIO));
+#endif
+        sv_sched();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * @file    timer.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Timekeeping Driver Software
+ ******************************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "timer.h"
+
+/* Private variables ----------------------------------------------------------*/
+static volatile uint8_t tmr_ovf; // TMR0 overflows, high byte of tmr_now()
+
+/**
+ * @brief Initialization of the time base
+ * @note TMR0 to be reserved as a free running 16-bit counter (one interrupt per 65536
+ *       machine cycles), TH0 being the low byte of the tick count
+ * @retval None
+ */
+void tmr_init(void)
+{
+    TR0 = 0;
+    TMOD = (TMOD & 0xF0) | M0_0;
+    TH0 = 0;
+    TL0 = 0;
+    EA = 1;
+    ET0 = 1;
+    TR0 = 1;
+}
+
+/**
+ * @brief Read the tick count
+ * @note Reads TH0 again if tmr_isr() ran in between. An overflow still pending (TF0
+ *       set, e.g. while sv_isr() runs or for the instruction before the vector) is
+ *       counted here if TH0 has already wrapped, so the count never steps back
+ * @retval Ticks since tmr_init() (wraps around)
+ */
+tmr_t tmr_now(void)
+{
+    uint8_t h, l;
+    bool f;
+    do {
+        h = tmr_ovf;
+        l = TH0;
+        f = TF0;
+    } while (h != tmr_ovf);
+    if (f && l < 0x80) // Wrapped (less than half a turn ago), not yet counted by tmr_isr()
+        h++;
+    return (tmr_t)h << 8 | l;
+}
+
+/**
+ * @brief Read TMR0 itself
+ * @note Reads TL0 again if it carried into TH0 in between
+ * @retval Machine cycles since tmr_init() (wraps around every 65536)
+ */
+uint16_t tmr_cycles(void)
+{
+    uint8_t h, l;
+    do {
+        h = TH0;
+        l = TL0;
+    } while (h != TH0);
+    return (uint16_t)h << 8 | l;
+}
+
+/**
+ * @brief Blocking wait of a given number of ticks
+ * @param ticks Time to wait, e.g. TMR_MS(5)
+ * @note Only for code with nothing else to do (initialization), poll tmr_expired() otherwise
+ * @retval None
+ */
+void tmr_wait(tmr_t ticks)
+{
+    tmr_t deadline = tmr_now() + ticks;
+    while (!tmr_expired(deadline));
+}
+
+/**
+ * @brief Extend the TMR0 count to 16-bit ticks
+ * @note TMR0 Interrupt Subroutine (TF0 cleared by hardware). INC direct leaves
+ *       every register and flag untouched
+ * @retval None
+ */
+void tmr_isr(void) __interrupt(TF0_VECTOR) __naked
+{
+    __asm
+    inc _tmr_ovf
+    reti
+    __endasm;
+}
\ No newline at end of file
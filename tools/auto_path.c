@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    auto_path.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Host tool converting AUTO_MODE_POINTS into servo counts at build time
+ ******************************************************************************
+ */
+
+/* Host build: skip the board SFRs and the SDCC-only keywords --------------*/
+#define LAB_BOARD_H
+#define __bit _Bool
+#define __interrupt(A)
+#define __using(A)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "servo.h"
+
+/* Private defines -----------------------------------------------------------*/
+#ifndef PI
+#define PI 3.1415926536 // As in SDCC's math.h
+#endif
+
+/* Private macros ------------------------------------------------------------*/
+#define SQR(A) ((A) * (A))
+
+/* Private typedefs ----------------------------------------------------------*/
+typedef struct {float x, y; _Bool z;} auto_pt_t; // AUTO_MODE_POINTS in centimeters
+
+/* Private functions' prototypes ----------------------------------------------*/
+static _Bool in_range(uint16_t cnt);
+
+/**
+ * @brief  Print AUTO_MODE_CNTS for the auto mode, evaluated as sv_move()'s float IK
+ * @retval 0 if every point is reachable, 1 otherwise (fails the build)
+ */
+int main(void)
+{
+    static const auto_pt_t pts[] = AUTO_MODE_POINTS;
+    unsigned i;
+    uint16_t base, mid;
+    float c, s, a; // cos, sin, alpha
+    printf("/* Generated by tools/auto_path.c from AUTO_MODE_POINTS, do not edit */\n");
+    printf("#ifndef AUTO_PATH_H\n#define AUTO_PATH_H\n\n#define AUTO_MODE_CNTS {\\\n");
+    for (i = 0; i < ARR_SIZE(pts); i++) {
+        c = (SQR(pts[i].x) + SQR(pts[i].y) - SQR(SV_L1) - SQR(SV_L2)) / (2 * SV_L1 * SV_L2);
+        if (fabsf(c) <= 1.0) {
+            a = atan2f(pts[i].y, pts[i].x) - atan2f(SV_L2 * (s = sqrtf(1 - SQR(c))), SV_L1 + SV_L2 * c);
+            if (a <= -PI)
+                a += 2 * PI;
+            base = SV_RTOC(a);
+            mid = SV_RTOC(atan2f(s, c));
+        }
+        if (fabsf(c) > 1.0 || !in_range(base) || !in_range(mid)) {
+            fprintf(stderr, "AUTO_MODE_POINTS[%u] = {%g, %g} is out of the arm's range\n",
+                    i, pts[i].x, pts[i].y);
+            return 1;
+        }
+        printf("    {%u, %u, %u},\\\n", base, mid, pts[i].z ? SV_MAX_CNT : SV_MIN_CNT);
+    }
+    printf("}\n\n#endif // AUTO_PATH_H\n");
+    return 0;
+}
+
+/**
+ * @brief  Same bounds as sv_setcnt()
+ * @param  cnt Pulse width given as a number of machine cycles
+ * @retval True if accepted by the servo driver
+ */
+static _Bool in_range(uint16_t cnt)
+{
+    return cnt >= SV_MIN_CNT && cnt <= SV_MAX_CNT;
+}
@@ -0,0 +1,290 @@
+/**
+ ******************************************************************************
+ * @file    ik_grid.c
+ * @author  agent
+ * @version V1.4.0
+ * @date    October 18th, 2026
+ * @brief   Host tool tabulating the BASE/MID counts of the SV_IK_GRID backend
+ ******************************************************************************
+ */
+
+/* Host build: skip the board SFRs and the SDCC-only keywords --------------*/
+#define LAB_BOARD_H
+#define __bit _Bool
+#define __interrupt(A)
+#define __using(A)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "servo.h"
+
+/* Private defines -----------------------------------------------------------*/
+#ifndef PI
+#define PI 3.1415926536 // As in SDCC's math.h
+#endif
+#define STEP  (1 << SV_IK_GRID_SHIFT)               // Grid step (Q8 cm)
+#define REACH ((int)((SV_L1 + SV_L2) * Q8_ONE + 1)) // Outer radius of the workspace (Q8 cm)
+#define NX    (2 * ((REACH + STEP - 1) / STEP) + 1) // Columns, centered on x = 0
+#define NY    ((REACH + STEP - 1) / STEP + 1)       // Rows from y = 0 (BASE ends at 0 and PI)
+#define X0    (-(NX / 2) * STEP)                    // x of the first column (Q8 cm)
+#define SUB   (STEP / 8)                            // Spacing of the cell checks (Q8 cm)
+
+#if SV_IK_GRID_SHIFT < 6 || SV_IK_GRID_SHIFT > 8 // Finer grids outgrow the 62 kB of flash
+#error "SV_IK_GRID_SHIFT must be between 6 and 8"
+#endif
+
+/* Private macros ------------------------------------------------------------*/
+#define SQR(A) ((A) * (A))
+#define NODE(IX, IY) grid[(IY) * NX + (IX)]
+#define CELL(IX, IY) cells[(IY) * (NX - 1) + (IX)]
+#define LERP8(A, B, F) ((B) >= (A) ? (A) + ((((B) - (A)) * (F) + 128) >> 8) : (A) - ((((A) - (B)) * (F) + 128) >> 8)) // As in servo.c
+
+/* Private typedefs ----------------------------------------------------------*/
+typedef struct {uint16_t base, mid; _Bool ok;} node_t;
+typedef struct {float x, y; _Bool z;} auto_pt_t; // AUTO_MODE_POINTS in centimeters
+
+/* Private variables ----------------------------------------------------------*/
+static node_t *grid;   // NX x NY nodes
+static _Bool *cells;   // (NX - 1) x (NY - 1) cells, true if usable
+
+/* Private functions' prototypes ----------------------------------------------*/
+static _Bool ik(int x, int y, node_t *n);
+static _Bool cell_ok(int ix, int iy);
+static _Bool lookup(int x, int y, node_t *n);
+#if SV_IK_MODE == SV_IK_GRID
+static _Bool covered(int x, int y);
+static _Bool points_ok(void);
+#endif
+static void interp(int ix, int iy, int fx, int fy, node_t *n);
+static int error(const node_t *a, const node_t *b);
+static _Bool in_range(uint16_t cnt);
+
+/**
+ * @brief  Print the SV_IK_GRID tables and report their error and size
+ * @note   Errors taken against sv_move()'s float IK, interpolated exactly as in servo.c.
+ *         Cells are checked SUB apart and reported on twice as many points. The
+ *         report goes to stderr and the generated header
+ * @retval 0 on success, 1 if a point outside the arm's range would be accepted or, with
+ *         SV_IK_MODE set to SV_IK_GRID, if a configured point would be refused
+ */
+int main(void)
+{
+    int ix, iy, x, y, err, max_err = 0;
+    long reach = 0, hits = 0, bad = 0;
+    unsigned bits = 0, size;
+    uint8_t byte = 0;
+    node_t ref, out;
+    grid = calloc(NX * NY, sizeof(*grid));
+    cells = calloc((NX - 1) * (NY - 1), sizeof(*cells));
+    if (!grid || !cells)
+        return 1;
+    for (iy = 0; iy < NY; iy++)
+        for (ix = 0; ix < NX; ix++)
+            NODE(ix, iy).ok = ik(X0 + ix * STEP, iy * STEP, &NODE(ix, iy));
+    for (iy = 0; iy < NY - 1; iy++)
+        for (ix = 0; ix < NX - 1; ix++)
+            CELL(ix, iy) = cell_ok(ix, iy);
+    for (y = 0; y < (NY - 1) * STEP; y += SUB / 2)
+        for (x = X0; x < X0 + (NX - 1) * STEP; x += SUB / 2) {
+            _Bool r = ik(x, y, &ref), a = lookup(x, y, &out);
+            reach += r;
+            hits += r && a;
+            bad += !r && a;
+            if (r && a && (err = error(&out, &ref)) > max_err)
+                max_err = err;
+        }
+    size = 2 * NX * NY * sizeof(uint16_t) + ((NX - 1) * (NY - 1) + 7) / 8;
+    fprintf(stderr, "SV_IK_GRID: %gx%g cm cells (%dx%d nodes), %u bytes of __code, max error %d counts, "
+            "%.1f%% of the workspace covered\n", (double)STEP / Q8_ONE, (double)STEP / Q8_ONE, NX, NY,
+            size, max_err, 100.0 * hits / reach);
+    printf("/* Generated by tools/ik_grid.c from SV_L1, SV_L2, SV_IK_GRID_SHIFT and SV_IK_GRID_TOL, do not edit */\n");
+    printf("/* Max error %d counts against the float IK, %.1f%% of the workspace covered, %u bytes */\n",
+           max_err, 100.0 * hits / reach, size);
+    printf("#ifndef IK_GRID_H\n#define IK_GRID_H\n\n");
+    printf("#define SV_GRID_NX %d\n#define SV_GRID_NY %d\n#define SV_GRID_X0 (%d)\n\n", NX, NY, X0);
+    printf("#define SV_GRID_BASE {\\\n");
+    for (iy = 0; iy < NY; iy++) {
+        printf("   ");
+        for (ix = 0; ix < NX; ix++)
+            printf(" %u,", NODE(ix, iy).base);
+        printf("\\\n");
+    }
+    printf("}\n\n#define SV_GRID_MID {\\\n");
+    for (iy = 0; iy < NY; iy++) {
+        printf("   ");
+        for (ix = 0; ix < NX; ix++)
+            printf(" %u,", NODE(ix, iy).mid);
+        printf("\\\n");
+    }
+    printf("}\n\n#define SV_GRID_REACH {\\\n   ");
+    for (iy = 0; iy < NY - 1; iy++)
+        for (ix = 0; ix < NX - 1; ix++) {
+            byte |= CELL(ix, iy) << (bits & 7);
+            if ((++bits & 7) == 0) {
+                printf(" 0x%02X,%s", byte, (bits & 127) ? "" : "\\\n   ");
+                byte = 0;
+            }
+        }
+    if (bits & 7)
+        printf(" 0x%02X,", byte);
+    printf("\\\n}\n\n#endif // IK_GRID_H\n");
+    if (bad) {
+        fprintf(stderr, "SV_IK_GRID would accept %ld points out of the arm's range\n", bad);
+        return 1;
+    }
+#if SV_IK_MODE == SV_IK_GRID
+    if (!points_ok())
+        return 1;
+#endif
+    return 0;
+}
+
+#if SV_IK_MODE == SV_IK_GRID
+/**
+ * @brief  Check that sv_move() accepts INITIAL_POSITION and AUTO_MODE_POINTS
+ * @note   A refused INITIAL_POSITION would leave the arm where it is on every return
+ *         to the idle state. Points are rounded to Q8 cm as by CM_TO_Q8
+ * @retval True if all of them lie in usable cells
+ */
+static _Bool points_ok(void)
+{
+    static const point_t init = INITIAL_POSITION;
+    static const auto_pt_t pts[] = AUTO_MODE_POINTS;
+    unsigned i;
+    _Bool ok = covered(init.x, init.y);
+    if (!ok)
+        fprintf(stderr, "INITIAL_POSITION = {%g, %g} is outside the SV_IK_GRID reachability bitmap\n",
+                (double)init.x / Q8_ONE, (double)init.y / Q8_ONE);
+    for (i = 0; i < ARR_SIZE(pts); i++)
+        if (!covered(CM_TO_Q8(pts[i].x), CM_TO_Q8(pts[i].y))) {
+            fprintf(stderr, "AUTO_MODE_POINTS[%u] = {%g, %g} is outside the SV_IK_GRID reachability bitmap\n",
+                    i, pts[i].x, pts[i].y);
+            ok = 0;
+        }
+    return ok;
+}
+#endif
+
+/**
+ * @brief  BASE/MID counts of a point, evaluated as sv_move()'s float IK
+ * @param  x Abscissa (Q8 cm)
+ * @param  y Ordinate (Q8 cm)
+ * @param  n Pointer to node_t receiving the counts (zero if out of range)
+ * @retval True if both counts are accepted by the servo driver
+ */
+static _Bool ik(int x, int y, node_t *n)
+{
+    double fx = (double)x / Q8_ONE, fy = (double)y / Q8_ONE, c, s, a;
+    n->base = n->mid = 0;
+    c = (SQR(fx) + SQR(fy) - SQR(SV_L1) - SQR(SV_L2)) / (2 * SV_L1 * SV_L2);
+    if (fabs(c) > 1.0)
+        return 0;
+    a = atan2(fy, fx) - atan2(SV_L2 * (s = sqrt(1 - SQR(c))), SV_L1 + SV_L2 * c);
+    if (a <= -PI)
+        a += 2 * PI;
+    if (a < MIN_ANGLE || a > MAX_ANGLE)
+        return 0;
+    n->base = SV_RTOC(a);
+    n->mid = SV_RTOC(atan2(s, c));
+    return in_range(n->base) && in_range(n->mid);
+}
+
+/**
+ * @brief  Check whether a cell can be used
+ * @param  ix Column of its lower left node
+ * @param  iy Row of its lower left node
+ * @note   Cells next to the workspace boundaries, where the angles change too fast for
+ *         a bilinear fit, are given up
+ * @retval True if all of it is reachable with an error of SV_IK_GRID_TOL counts at most
+ */
+static _Bool cell_ok(int ix, int iy)
+{
+    int x, y;
+    node_t ref, out;
+    if (!NODE(ix, iy).ok || !NODE(ix + 1, iy).ok || !NODE(ix, iy + 1).ok || !NODE(ix + 1, iy + 1).ok)
+        return 0;
+    for (y = 0; y <= STEP; y += SUB)
+        for (x = 0; x <= STEP; x += SUB) {
+            if (!ik(X0 + ix * STEP + x, iy * STEP + y, &ref))
+                return 0;
+            interp(ix, iy, x << (8 - SV_IK_GRID_SHIFT), y << (8 - SV_IK_GRID_SHIFT), &out);
+            if (error(&out, &ref) > SV_IK_GRID_TOL)
+                return 0;
+        }
+    return 1;
+}
+
+/**
+ * @brief  Counts of a point as interpolated by servo.c
+ * @param  x Abscissa (Q8 cm)
+ * @param  y Ordinate (Q8 cm)
+ * @param  n Pointer to node_t receiving the counts
+ * @retval True if the point lies in a reachable cell
+ */
+static _Bool lookup(int x, int y, node_t *n)
+{
+    int ix = (x - X0) >> SV_IK_GRID_SHIFT, iy = y >> SV_IK_GRID_SHIFT;
+    if (!CELL(ix, iy))
+        return 0;
+    interp(ix, iy, (uint8_t)((x - X0) << (8 - SV_IK_GRID_SHIFT)), (uint8_t)(y << (8 - SV_IK_GRID_SHIFT)), n);
+    return 1;
+}
+
+#if SV_IK_MODE == SV_IK_GRID
+/**
+ * @brief  Bounds and bitmap checks of sv_move()
+ * @param  x Abscissa (Q8 cm)
+ * @param  y Ordinate (Q8 cm)
+ * @retval True if the point lies in a usable cell
+ */
+static _Bool covered(int x, int y)
+{
+    node_t n;
+    if (x < X0 || x >= X0 + (NX - 1) * STEP || y < 0 || y >= (NY - 1) * STEP)
+        return 0;
+    return lookup(x, y, &n);
+}
+#endif
+
+/**
+ * @brief  Bilinear interpolation of a cell as in servo.c
+ * @param  ix Column of its lower left node
+ * @param  iy Row of its lower left node
+ * @param  fx Horizontal fraction of the cell (1/256, 256 for its right edge)
+ * @param  fy Vertical fraction of the cell (1/256, 256 for its top edge)
+ * @param  n Pointer to node_t receiving the counts
+ * @retval None
+ */
+static void interp(int ix, int iy, int fx, int fy, node_t *n)
+{
+    uint16_t lo, hi;
+    lo = LERP8(NODE(ix, iy).base, NODE(ix + 1, iy).base, fx);
+    hi = LERP8(NODE(ix, iy + 1).base, NODE(ix + 1, iy + 1).base, fx);
+    n->base = LERP8(lo, hi, fy);
+    lo = LERP8(NODE(ix, iy).mid, NODE(ix + 1, iy).mid, fx);
+    hi = LERP8(NODE(ix, iy + 1).mid, NODE(ix + 1, iy + 1).mid, fx);
+    n->mid = LERP8(lo, hi, fy);
+}
+
+/**
+ * @brief  Largest count error of a lookup
+ * @param  a Pointer to the interpolated counts
+ * @param  b Pointer to the float IK counts
+ * @retval Error in machine cycles (counts)
+ */
+static int error(const node_t *a, const node_t *b)
+{
+    int eb = abs((int)a->base - b->base), em = abs((int)a->mid - b->mid);
+    return eb > em ? eb : em;
+}
+
+/**
+ * @brief  Same bounds as sv_setcnt()
+ * @param  cnt Pulse width given as a number of machine cycles
+ * @retval True if accepted by the servo driver
+ */
+static _Bool in_range(uint16_t cnt)
+{
+    return cnt >= SV_MIN_CNT && cnt <= SV_MAX_CNT;
+}